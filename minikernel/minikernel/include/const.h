@@ -22,10 +22,21 @@
 #define NULL (void *) 0		/* por si acaso no esta ya definida */
 #endif
 
-#define MAX_PROC 10		/* dimension de tabla de procesos */
+#define TAM_BLOQUE_PROCS 16		/* BCPs que se reservan cada vez que crece la tabla */
+#define MAX_BLOQUES_PROCS 256	/* numero maximo de bloques de la tabla */
+#define MAX_PROC (TAM_BLOQUE_PROCS*MAX_BLOQUES_PROCS)	/* dimension maxima de tabla de procesos */
+#define MAX_ID_PROC 32768		/* los ids se asignan ciclicamente en [0, MAX_ID_PROC) */
+#define TAM_HASH_PROCS 256		/* entradas de la tabla hash de ids de proceso */
 
 #define TAM_PILA 32768
 
+/* constante usada en la cache de imagenes de programas */
+#define MAX_IMAGENES_RESIDENTES 4	/* imagenes sin usar que se mantienen cargadas */
+
+/* constantes usadas en la reserva de pilas */
+#define POOL_PILAS_MAX 8	/* marca alta: maximo de pilas libres que se conservan */
+#define POOL_PILAS_MIN 2	/* marca baja: pilas libres que se reponen en reposo */
+
 
 /*
  * Posibles estados del proceso
@@ -61,14 +72,69 @@
 #define LLAM_SIS 4      /* vector usado para llamadas */
 #define INT_SW 5	/* vector usado para interrupciones software */
 
+/* descomentar (o compilar con -DDEPURAR_LISTAS) para comprobar los
+   invariantes de las listas de BCPs tras cada operacion */
+/* #define DEPURAR_LISTAS */
+
+/* trazas del kernel: niveles, de menor a mayor gravedad */
+#define TRAZA_DEPURACION 0	/* detalle de cada tick, cambio de contexto, etc. */
+#define TRAZA_INFO 1		/* eventos normales: creacion de procesos, mutex... */
+#define TRAZA_AVISO 2		/* errores de los procesos en las llamadas */
+#define TRAZA_ERROR 3		/* errores del propio sistema */
+
+/* subsistemas de las trazas (mascara de bits) */
+#define TRAZA_INT 0x01		/* tratamiento de interrupciones */
+#define TRAZA_PLANIF 0x02	/* planificacion y cambios de contexto */
+#define TRAZA_PROC 0x04		/* creacion, terminacion y excepciones de procesos */
+#define TRAZA_MUTEX 0x08	/* mutex */
+#define TRAZA_LLAMSIS 0x10	/* resto de llamadas al sistema */
+#define TRAZA_TODOS 0xff
+
+/* nivel minimo y subsistemas de las trazas que se compilan: las demas
+   desaparecen del codigo. Compilar con -DNIVEL_TRAZAS=TRAZA_DEPURACION
+   para incluir las de depuracion */
+#ifndef NIVEL_TRAZAS
+#define NIVEL_TRAZAS TRAZA_INFO
+#endif
+#define SUBSISTEMAS_TRAZAS TRAZA_TODOS
+
+/* anillo de trazas: se vuelca en reposo, en panico y al apagar */
+#define NUM_TRAZAS 256		/* mensajes que caben (se pierden los mas antiguos) */
+#define TAM_TRAZA 96		/* longitud maxima de un mensaje */
+
 /* frecuencia de reloj requerida (ticks/segundo) */
 #define TICK 100
 
+/* modo sin ticks en reposo: 1 suprime el tratamiento de los ticks que no
+   vencen ningun plazo mientras no hay procesos listos, 0 lo desactiva */
+#define MODO_SIN_TICKS 1
+
 /* constante usada en implementacion de round robin */
 #define TICKS_POR_RODAJA 5
 
+/* constantes usadas en implementacion de planificacion por prioridades */
+#define NUM_PRIORIDADES 32		/* numero de niveles de prioridad (0 es la maxima) */
+#define PRIORIDAD_DEFECTO 16	/* prioridad con la que se crea un proceso */
+#define MAX_CADENA_HERENCIA 16	/* mutex que se recorren como mucho al seguir una cadena de esperas */
+
+/*
+ * Deteccion de interbloqueos en lock: con INTERBLOQUEO_FALLAR la espera
+ * que cerraria un ciclo devuelve ERROR_INTERBLOQUEO; con INTERBLOQUEO_AVISAR
+ * solo se registra y el proceso se bloquea igualmente.
+ * Se puede fijar al compilar con -DDETECCION_INTERBLOQUEOS=...
+ */
+#define INTERBLOQUEO_FALLAR 0
+#define INTERBLOQUEO_AVISAR 1
+
+#ifndef DETECCION_INTERBLOQUEOS
+#define DETECCION_INTERBLOQUEOS INTERBLOQUEO_FALLAR
+#endif
+
 /* constantes usada en implementacion de mutex */
-#define NUM_MUT 16 		/* numero total de mutex en el sistema */
+#define TAM_BLOQUE_MUTEX 16	/* mutex que se añaden cada vez que crece la tabla */
+#define MAX_BLOQUES_MUTEX 256	/* bloques maximos de la tabla de mutex */
+#define NUM_MUT (TAM_BLOQUE_MUTEX*MAX_BLOQUES_MUTEX) /* numero total de mutex en el sistema */
+#define TAM_HASH_MUTEX 256	/* entradas de la tabla hash de nombres de mutex */
 #define NUM_MUT_PROC 4 	/* numero maximo de mutex que puede tener abiertos un proceso */
 #define MAX_NOM_MUT 8 	/* longitud maxima de un nombre de mutex */
 /* -----------cosas añadidias para mutex----------- */
@@ -21,13 +21,87 @@
 /* -----------cosas añadidas para mutex----------- */
 #define NO_RECURSIVO 0	/* tipo de mutex no recursivo */
 #define RECURSIVO 1		/* tipo de mutex recursivo */
+#define TRASPASO 2		/* se combina con el tipo: unlock cede el mutex al primero que
+						   espera en vez de dejarlo libre (equidad frente a rendimiento) */
+#define ERROR_PLAZO -2	/* lock_temporizado: vencio el plazo sin conseguir el mutex */
+#define ERROR_INTERBLOQUEO -3	/* lock: esperar cerraria un ciclo de esperas entre procesos */
 #define LOCKED 0		/* mutex bloqueado */
 #define UNLOCKED 1		/* mutex desbloqueado */
 
+/* palabra de un mutex, compartida entre el kernel y los procesos que lo
+   tienen abierto: sin contienda lock y unlock la modifican atomicamente
+   sin llamada al sistema. estado vale 0 si esta libre o el id+1 del
+   propietario, con MUTEX_ESPERANDO activo mientras haya procesos en su
+   lista de espera, incluso libre tras un unlock que despierta a uno: asi
+   lock y unlock nunca lo cambian sin llamada si queda alguien esperando */
+#define MUTEX_ESPERANDO 0x40000000
+#define MUTEX_PROPIETARIO 0x3fffffff
+
+struct palabra_mutex {
+	int estado;			/* propietario y bit de espera */
+	int contador;		/* bloqueos del propietario (solo lo modifica el) */
+	int tipo;			/* NO_RECURSIVO|RECURSIVO, con TRASPASO si procede */
+};
+
+/* estadisticas de un mutex (llamada estad_mutex) */
+struct estad_mutex {
+	unsigned long esperas;		/* veces que un lock ha tenido que esperar */
+	unsigned long traspasos;	/* unlocks que han cedido el mutex a un proceso en espera */
+	unsigned long fallos_readquisicion;	/* despertados que lo encontraron ocupado de nuevo */
+	unsigned long interbloqueos;	/* esperas que habrian cerrado un ciclo */
+};
+
 #include "const.h"
 #include "HAL.h"
 #include "llamsis.h"
 
+/* ---------anillo de llamadas--------- */
+/* tipos del anillo compartido con el que un proceso encola varias llamadas
+   al sistema y las hace tratar con una sola entrada al kernel */
+#define TAM_ANILLO 64		/* entradas de cada cola del anillo */
+
+struct peticion_llamada {
+	int servicio;			/* numero de la llamada */
+	long args[3];			/* parametros de la llamada */
+	long dato;				/* dato del usuario que se copia al resultado */
+};
+
+struct resultado_llamada {
+	long dato;				/* dato de la peticion correspondiente */
+	int resultado;			/* valor devuelto por la llamada */
+};
+
+struct anillo_llamadas {
+	unsigned int cab_pet;	/* siguiente peticion a tratar (la avanza el kernel) */
+	unsigned int cola_pet;	/* siguiente peticion libre (la avanza el usuario) */
+	unsigned int cab_res;	/* siguiente resultado a leer (la avanza el usuario) */
+	unsigned int cola_res;	/* siguiente resultado libre (la avanza el kernel) */
+	struct peticion_llamada peticiones[TAM_ANILLO];
+	struct resultado_llamada resultados[TAM_ANILLO];
+};
+
+/* ---------escritura vectorial--------- */
+/* segmento de una escritura vectorial (escribirv) */
+#define MAX_SEGMENTOS 16	/* maximo de segmentos por llamada */
+
+struct segmento {
+	char *texto;			/* direccion del segmento */
+	unsigned int longi;		/* longitud en bytes */
+};
+
+/* ---------estadisticas de llamadas--------- */
+/* contadores de una llamada al sistema. La latencia se mide en ticks y se
+   acumula en un histograma logaritmico: la cubeta 0 cuenta las llamadas de
+   0 ticks y la cubeta i (i>0) las de [2^(i-1), 2^i) ticks; la ultima
+   recoge ademas todas las mas largas */
+#define NUM_CUBETAS_LATENCIA 12
+
+struct estad_llamada {
+	unsigned long llamadas;		/* veces que se ha invocado */
+	unsigned long errores;		/* veces que ha devuelto un valor negativo */
+	unsigned long latencia[NUM_CUBETAS_LATENCIA];	/* histograma de duracion */
+};
+
 /*
  *
  * Definicion del tipo que corresponde con el BCP.
@@ -35,22 +109,72 @@
  *
  */
 typedef struct BCP_t *BCPptr;
+typedef struct MUTEX_t *MUTEXptr;	/* definido mas abajo, lo usa el BCP */
+
+/*
+ * Definicion del tipo que corresponde con una imagen de programa cargada.
+ * Las imagenes se comparten entre los procesos del mismo programa y las
+ * que quedan sin usar se mantienen cargadas (cache LRU de tamano
+ * MAX_IMAGENES_RESIDENTES). Al reutilizar una que no usaba nadie se
+ * restauran sus datos escribibles con la copia tomada al cargarla.
+ */
+typedef struct imagen_t *IMAGENptr;
+
+typedef struct imagen_t {
+	char *nombre;				/* programa del que procede la imagen */
+	void *mem;					/* descriptor del mapa devuelto por crear_imagen */
+	void *pc_inicial;			/* punto de arranque del programa */
+	int referencias;			/* numero de procesos que usan la imagen */
+	unsigned long ultimo_uso;	/* marca de uso para la politica LRU */
+	void *datos;				/* datos escribibles (.data y .bss) de la imagen */
+	void *copia_datos;			/* su contenido recien cargada (NULL si no hay copia) */
+	unsigned long tam_datos;	/* tamano de datos y copia_datos */
+	IMAGENptr siguiente;		/* siguiente imagen cargada */
+} imagen;
 
 typedef struct BCP_t {
     int id;						/* ident. del proceso */
     int estado;					/* TERMINADO|LISTO|EJECUCION|BLOQUEADO*/
     contexto_t contexto_regs;	/* copia de regs. de UCP */
     void * pila;				/* dir. inicial de la pila */
-	BCPptr siguiente;			/* puntero a otro BCP */
+	BCPptr siguiente;			/* puntero al siguiente BCP de su lista */
+	BCPptr anterior;			/* puntero al anterior BCP de su lista */
+	struct lista_BCPs_t *lista;	/* lista en la que esta el BCP (NULL si ninguna) */
+	BCPptr sig_hash;			/* siguiente BCP en la misma entrada de hash_procs */
 	void *info_mem;				/* descriptor del mapa de memoria */
+	IMAGENptr imagen;			/* imagen (compartida) de la que procede info_mem */
 	/* -----------cosas añadidas----------- */
 	/* añadidos para la llamada dormir */
-	int tiempo_dormir;			/* tiempo que se queda el proceso dormido */
+	unsigned long despertar;	/* tick absoluto en el que debe despertar */
+	/* enlaces propios de la lista de plazos, para poder estar a la vez en
+	   ella y en la lista de espera de un mutex (lock_temporizado) */
+	BCPptr sig_plazo;			/* siguiente BCP de la lista de plazos */
+	BCPptr ant_plazo;			/* anterior BCP de la lista de plazos */
+	int en_plazos;				/* 1 si esta en la lista de plazos */
+	int plazo_vencido;			/* 1 si el reloj lo saco de una lista de espera */
 	/* añadidos para mutex */
-	int descriptores[NUM_MUT_PROC];	/* conjunto de descriptores vinculados con los mutex usados por el proceso */
+	MUTEXptr descriptores[NUM_MUT_PROC];	/* mutex abiertos por el proceso (NULL si el descriptor esta libre) */
 	int num_descriptores_abiertos;		/* guarda el numero de descriptores abiertos por el proceso */
+	int lecturas[NUM_MUT_PROC];			/* bloqueos en lectura de cada cerrojo abierto */
+	int unidades_pedidas;				/* unidades que espera de un semaforo */
 	/* añadidos para round-robin */
 	int contadorTicks;
+	/* añadidos para prioridades */
+	int prioridad;				/* nivel de prioridad efectivo (0 es la maxima) */
+	int prioridad_base;			/* la fijada con fijar_prioridad, sin herencia */
+	MUTEXptr mutex_esperado;	/* mutex por el que esta bloqueado en lock (o NULL) */
+	/* añadidos para contabilidad */
+	int ticks_usuario;			/* ticks de reloj ejecutando en modo usuario */
+	int ticks_sistema;			/* ticks de reloj ejecutando en modo sistema */
+	/* añadidos para la pagina de informacion */
+	unsigned long serie;		/* numero de serie, a diferencia del id nunca se reutiliza */
+	/* añadidos para el anillo de llamadas */
+	struct anillo_llamadas *anillo;	/* anillo registrado por el proceso (NULL si ninguno) */
+	/* añadidos para estadisticas de llamadas */
+	struct estad_llamada estad_llamadas[NSERVICIOS];	/* contadores del proceso */
+	/* añadidos para hilos */
+	void *funcion_hilo;			/* funcion que ejecuta el hilo (NULL si no es un hilo) */
+	void *arg_hilo;				/* argumento de la funcion del hilo */
 } BCP;
 
 /*
@@ -61,7 +185,7 @@ typedef struct BCP_t {
  *
  */
 
-typedef struct{
+typedef struct lista_BCPs_t{
 	BCP *primero;
 	BCP *ultimo;
 } lista_BCPs;
@@ -74,44 +198,147 @@ typedef struct{
 BCP * p_proc_actual=NULL;
 
 /*
- * Variable global que representa la tabla de procesos
+ * Variables globales que representan la tabla de procesos: bloques de
+ * BCPs reservados dinamicamente, lista de BCPs libres (enlazados por el
+ * campo siguiente) y tabla hash de BCPs en uso indexada por id
  */
 
-BCP tabla_procs[MAX_PROC];
+BCP *bloques_procs[MAX_BLOQUES_PROCS];
+int num_bloques_procs=0;
+BCP *procs_libres=NULL;
+BCP *hash_procs[TAM_HASH_PROCS];
+int siguiente_id=0;		/* proximo id a asignar */
+int num_procesos=0;		/* numero de procesos vivos */
 
 /*
- * Variable global que representa la cola de procesos listos
+ * Variable global que representa la cola de procesos listos: una lista
+ * por nivel de prioridad y un mapa de bits con los niveles no vacios
+ * (bit i activo si lista_listos[i] tiene algun proceso)
  */
-lista_BCPs lista_listos= {NULL, NULL};
+lista_BCPs lista_listos[NUM_PRIORIDADES];
+unsigned int mapa_listos=0;
 
 /** ----------------------------Estructuras de datos añadidas---------------------------- **/
 
 /* ---------llamada al sistema dormir--------- */
-/* Variable global que representa la cola de procesos bloqueados por la llamada al sistema dormir()*/
+/* Variable global que representa la cola de procesos bloqueados por la llamada al sistema dormir(),
+   ordenada por tick absoluto de despertar */
 lista_BCPs lista_bloqueados_dormir = {NULL,NULL};
 
+/* Variable global que cuenta los ticks de reloj desde el arranque */
+unsigned long ticks_totales=0;
+
+/* ---------trazas del kernel--------- */
+/* anillo en memoria con los mensajes pendientes de volcar a la consola */
+char trazas[NUM_TRAZAS][TAM_TRAZA];
+unsigned long trazas_cab=0;			/* siguiente mensaje a volcar */
+unsigned long trazas_cola=0;		/* siguiente mensaje a escribir */
+unsigned long trazas_perdidas=0;	/* mensajes sobrescritos sin volcar */
+
+/* registra un mensaje si su nivel y subsistema se compilan; si no, la
+   condicion es constante y el compilador elimina la llamada */
+#define traza(nivel, subsistema, ...) \
+	do { \
+		if ((nivel)>=NIVEL_TRAZAS && ((subsistema)&SUBSISTEMAS_TRAZAS)) \
+			registrar_traza(__VA_ARGS__); \
+	} while (0)
+
+/* ---------pagina de informacion del kernel--------- */
+/* pagina de solo lectura para los procesos que el kernel mantiene al dia,
+   de modo que pueden leer estos datos sin hacer una llamada al sistema */
+struct info_kernel {
+	int id_proceso;			/* id del proceso en ejecucion */
+	unsigned long ticks;	/* ticks de reloj desde el arranque */
+	int ticks_rodaja;		/* ticks que le quedan de rodaja al proceso en ejecucion */
+	int num_listos;			/* procesos listos (incluido el que esta en ejecucion) */
+	unsigned long serie_proceso;	/* numero de serie (nunca reutilizado) del proceso en ejecucion */
+};
+struct info_kernel pagina_info;
+unsigned long siguiente_serie=1;	/* proximo numero de serie de proceso (0 no se usa) */
+
+/* contadores globales de cada llamada al sistema */
+struct estad_llamada estad_llamadas[NSERVICIOS];
+
+/* ---------cache de imagenes--------- */
+IMAGENptr lista_imagenes=NULL;				/* imagenes cargadas (en uso o residentes) */
+int num_imagenes_residentes=0;				/* imagenes cargadas sin ningun proceso */
+unsigned long marca_uso_imagenes=0;			/* reloj logico para la politica LRU */
+unsigned long aciertos_cache_imagenes=0;
+unsigned long fallos_cache_imagenes=0;
+
+/* ---------reserva de pilas--------- */
+void *pool_pilas[POOL_PILAS_MAX];		/* pilas liberadas listas para reutilizar */
+int num_pilas_pool=0;
+unsigned long aciertos_pool_pilas=0;	/* pilas servidas desde la reserva */
+unsigned long fallos_pool_pilas=0;		/* pilas que hubo que crear */
+
+/* ---------contabilidad--------- */
+/* definicion del tipo usado por la llamada tiempos_proceso */
+struct tiempos_ejec {
+	int usuario;		/* ticks en modo usuario */
+	int sistema;		/* ticks en modo sistema */
+};
+
+/* Variable global que indica que se esta accediendo a un parametro de una
+   llamada que esta en la memoria del proceso */
+int accediendo_parametro=0;
+
+/* ---------reposo sin ticks--------- */
+int en_reposo=0;					/* 1 mientras se espera sin procesos listos */
+unsigned long plazo_reposo;			/* tick del primer plazo que vence durante el reposo */
+unsigned long ticks_suprimidos=0;	/* ticks de reloj no tratados por estar en reposo */
+
 /* ---------mutex--------- */
 /* definicion de tipo que corresponde con un mutex */
 
-typedef struct MUTEX_t *MUTEXptr;
+/* clases de objeto de la tabla de mutex: comparten nombres y descriptores */
+#define CLASE_MUTEX 0
+#define CLASE_COND 1
+#define CLASE_RW 2
+#define CLASE_SEM 3
 
 typedef struct MUTEX_t{
-	char nombre[MAX_NOM_MUT];							/* nombre del mutex */
+	char nombre[MAX_NOM_MUT+1];							/* nombre del mutex */
+	int clase;											/* CLASE_MUTEX|CLASE_COND|CLASE_RW|CLASE_SEM */
 	int estado;											/* estado de mutex LIBRE|OCUPADO */
-	int tipo;											/* tipo de mutex NO RECURSIVO|RECURSIVO */
 	int num_procesos_esperando;							/* contador de procesos esperando al mutex */
 	lista_BCPs lista_procesos_esperando;				/* lista de procesos esperando al mutex */
-	int	id_proceso_propietario;							/* puntero al proceso actual poseedor del mutex */
-	int contador_bloqueos;								/* contador de bloqueos del mutex */
-	int mutex_lock;										/* 1 - LOCK | 0 - UNLOCK */
+	struct palabra_mutex palabra;						/* propietario, bloqueos y tipo (compartida con los procesos) */
+	struct estad_mutex estad;							/* contadores de esperas y traspasos */
+	/* cerrojos de lectura/escritura: el escritor es el propietario de la
+	   palabra y lista_procesos_esperando la cola de escritores */
+	int lectores;										/* procesos que lo tienen en lectura */
+	int num_lectores_esperando;							/* contador de lectores esperando */
+	lista_BCPs lista_lectores;							/* lista de lectores esperando */
+	int valor;											/* unidades disponibles de un semaforo */
+	int num_abiertos;									/* descriptores que lo tienen abierto */
+	MUTEXptr sig_hash;									/* siguiente mutex en la misma entrada de hash_mutex */
+	MUTEXptr sig_libre;									/* siguiente mutex en la lista de libres */
 } mutex;
 
-mutex lista_mutex[NUM_MUT];			/* lista de nombres de mutex en el sistema */
+/* id del proceso propietario de un mutex (-1 si esta libre) */
+#define PROPIETARIO_MUTEX(m) (((m)->palabra.estado&MUTEX_PROPIETARIO)-1)
+
+/* mutex sin propietario, aunque tenga activo el bit de espera */
+#define MUTEX_LIBRE(m) (((m)->palabra.estado&MUTEX_PROPIETARIO)==0)
+
+/* objeto asociado a un descriptor del proceso actual segun su clase */
+#define mutex_de_descriptor(d) objeto_de_descriptor((d), CLASE_MUTEX)
+#define cond_de_descriptor(d) objeto_de_descriptor((d), CLASE_COND)
+#define rw_de_descriptor(d) objeto_de_descriptor((d), CLASE_RW)
+#define sem_de_descriptor(d) objeto_de_descriptor((d), CLASE_SEM)
+
+/* tabla de mutex: bloques que se reservan segun se necesitan, lista de
+   mutex libres y tabla hash por nombre de los que estan en uso */
+MUTEXptr bloques_mutex[MAX_BLOQUES_MUTEX];
+int num_bloques_mutex=0;
+MUTEXptr mutex_libres=NULL;
+MUTEXptr hash_mutex[TAM_HASH_MUTEX];
 int contador_lista_mutex;			/* contador de mutex en el sistema */
+struct estad_mutex estad_mutex_total;	/* contadores acumulados de todos los mutex */
 
-/* Variable global que representa la cola de procesos esperando al mutex*/
+/* Variable global que representa la cola de procesos esperando a que se libere un mutex */
 lista_BCPs lista_bloqueados_mutex = {NULL,NULL};
-int contador_lista_bloqueados_mutex;
 
 /** ------------------------------------------------------------------------------------ **/
 
@@ -129,14 +356,48 @@ typedef struct{
 
 /*---------prototipos de funciones auxiliares---------*/
 /* funciones para dormir */
-void cuentaAtrasBloqueados();
+void despertarDormidos();
 
 /* funciones para mutex */
-int buscarPosicionMutexLibre();
-int buscarMutexPorNombre(char *nombre);
+void iniciar_tabla_mutex();
+MUTEXptr buscar_mutex_libre();
+void liberar_mutex(MUTEXptr m);
+MUTEXptr buscar_mutex_por_nombre(char *nombre);
+void insertar_mutex_por_nombre(MUTEXptr m);
+int leer_nombre_mutex(char *nombre, char *destino);
 int buscarDescriptorLibrePorceso();
-int* buscarMutexPorID(int mutexid);
-void iniciar_lista_mutex();
+MUTEXptr objeto_de_descriptor(unsigned int desc, int clase);
+void dar_palabra_mutex(struct palabra_mutex **palabra, MUTEXptr m);
+void bloquear_proceso_actual(lista_BCPs *lista);
+void liberar_lock(MUTEXptr m);
+BCPptr propietario_mutex(MUTEXptr m);
+int prioridad_heredada(BCPptr p);
+void propagar_prioridad(BCPptr p);
+int hay_interbloqueo(MUTEXptr m);
+void cambiar_prioridad(BCPptr p, int prioridad);
+int cerrar_descriptor(unsigned int desc);
+void cerrar_mutex_proceso();
+
+/* funciones para la cache de imagenes */
+IMAGENptr obtener_imagen(char *prog);
+void retener_imagen(IMAGENptr img);
+void soltar_imagen(IMAGENptr img);
+void vaciar_cache_imagenes();
+
+/* funciones para la reserva de pilas */
+void * obtener_pila();
+void devolver_pila(void *pila);
+void rellenar_pool_pilas();
+
+/* trazas del kernel */
+void registrar_traza(const char *formato, ...);
+void vaciar_trazas();
+void panico_kernel(char *mens);
+
+/* estadisticas del sistema */
+void mostrar_estadisticas();
+int ejecutar_servicio(int nserv);
+void mostrar_estad_llamadas();
 
 /* funciones para round-robin */
 void actualizarTick();
@@ -151,11 +412,41 @@ int sis_escribir();
 /* prototipos de rutinas añadidos */
 int obtener_id_pr();
 int dormir(unsigned int segundos);
-int crear_mutex(char *nombre, int tipo);
-int abrir_mutex(char *nombre);
+int crear_mutex(char *nombre, int tipo, struct palabra_mutex **palabra);
+int abrir_mutex(char *nombre, struct palabra_mutex **palabra);
 int lock(unsigned int mutexid);
+int lock_temporizado(unsigned int mutexid, unsigned int ticks);
 int unlock(unsigned int mutexid);
 int cerrar_mutex(unsigned int mutexid);
+int estad_mutex(unsigned int mutexid, struct estad_mutex *estad);
+int crear_cond(char *nombre);
+int abrir_cond(char *nombre);
+int esperar_cond(unsigned int condid, unsigned int mutexid);
+int senalar_cond(unsigned int condid);
+int difundir_cond(unsigned int condid);
+int cerrar_cond(unsigned int condid);
+int crear_rw(char *nombre);
+int abrir_rw(char *nombre);
+int lock_lectura(unsigned int rwid);
+int lock_escritura(unsigned int rwid);
+int unlock_rw(unsigned int rwid);
+int cerrar_rw(unsigned int rwid);
+int crear_sem(char *nombre, int valor);
+int abrir_sem(char *nombre);
+int esperar_sem(unsigned int semid, int n);
+int senalar_sem(unsigned int semid, int n);
+int cerrar_sem(unsigned int semid);
+int fijar_prioridad(unsigned int prioridad);
+int crear_procesos(char *prog, unsigned int n, int *ids);
+int crear_hilo(void *lanzadera, void *funcion, void *arg);
+int datos_hilo(void **funcion, void **arg);
+int tiempos_proceso(struct tiempos_ejec *tiempos);
+int registrar_anillo(struct anillo_llamadas *anillo);
+int entrar_anillo();
+int obtener_info_kernel(struct info_kernel **pagina);
+int serie_viva(unsigned long serie);
+int obtener_estad_llamadas(int servicio, struct estad_llamada *estad, int solo_proceso);
+int sis_escribirv();
 /*
  * Variable global que contiene las rutinas que realizan cada llamada
  */
@@ -169,7 +460,37 @@ servicio tabla_servicios[NSERVICIOS]={
 					{abrir_mutex},
 					{lock},
 					{unlock},
-					{cerrar_mutex}
+					{cerrar_mutex},
+					{fijar_prioridad},
+					{crear_procesos},
+					{crear_hilo},
+					{datos_hilo},
+					{tiempos_proceso},
+					{registrar_anillo},
+					{entrar_anillo},
+					{obtener_info_kernel},
+					{obtener_estad_llamadas},
+					{sis_escribirv},
+					{estad_mutex},
+					{crear_cond},
+					{abrir_cond},
+					{esperar_cond},
+					{senalar_cond},
+					{difundir_cond},
+					{cerrar_cond},
+					{crear_rw},
+					{abrir_rw},
+					{lock_lectura},
+					{lock_escritura},
+					{unlock_rw},
+					{cerrar_rw},
+					{crear_sem},
+					{abrir_sem},
+					{esperar_sem},
+					{senalar_sem},
+					{cerrar_sem},
+					{lock_temporizado},
+					{serie_viva}
 					};
 
 #endif /* _KERNEL_H */
@@ -19,7 +19,7 @@
 #define _LLAMSIS_H
 
 /* Numero de llamadas disponibles */
-#define NSERVICIOS 10
+#define NSERVICIOS 40
 
 #define CREAR_PROCESO 0
 #define TERMINAR_PROCESO 1
@@ -31,6 +31,36 @@
 #define LOCK 7
 #define UNLOCK 8
 #define CERRAR_MUTEX 9
+#define FIJAR_PRIORIDAD 10
+#define CREAR_PROCESOS 11
+#define CREAR_HILO 12
+#define DATOS_HILO 13
+#define TIEMPOS_PROCESO 14
+#define REGISTRAR_ANILLO 15
+#define ENTRAR_ANILLO 16
+#define OBTENER_INFO_KERNEL 17
+#define OBTENER_ESTAD_LLAMADAS 18
+#define ESCRIBIRV 19
+#define ESTAD_MUTEX 20
+#define CREAR_COND 21
+#define ABRIR_COND 22
+#define ESPERAR_COND 23
+#define SENALAR_COND 24
+#define DIFUNDIR_COND 25
+#define CERRAR_COND 26
+#define CREAR_RW 27
+#define ABRIR_RW 28
+#define LOCK_LECTURA 29
+#define LOCK_ESCRITURA 30
+#define UNLOCK_RW 31
+#define CERRAR_RW 32
+#define CREAR_SEM 33
+#define ABRIR_SEM 34
+#define ESPERAR_SEM 35
+#define SENALAR_SEM 36
+#define CERRAR_SEM 37
+#define LOCK_TEMPORIZADO 38
+#define SERIE_VIVA 39
 
 #endif /* _LLAMSIS_H */
 
@@ -12,13 +12,26 @@
  * Fichero que contiene la funcionalidad del sistema operativo
  *
  */
+#define _GNU_SOURCE	/* dl_iterate_phdr en link.h */
+#include <stdio.h>	/* vsnprintf */
+#include <stdarg.h>
 #include <string.h>	/* añadida libreria string */
+#include <stdlib.h>	/* malloc */
+#include <strings.h>	/* ffs */
+#include <limits.h>	/* INT_MAX */
+#include <link.h>		/* dl_iterate_phdr */
 #include "kernel.h"	/* Contiene defs. usadas por este modulo */
 
 /*
  *
  * Funciones relacionadas con la tabla de procesos:
- *	iniciar_tabla_proc buscar_BCP_libre
+ *	iniciar_tabla_proc crecer_tabla_proc buscar_BCP_libre liberar_BCP
+ *	asignar_id buscar_BCP_por_id buscar_BCP_por_serie
+ *
+ * La tabla crece por bloques de TAM_BLOQUE_PROCS BCPs que nunca se
+ * liberan, por lo que los punteros a BCP son estables. Las entradas
+ * libres forman una lista enlazada por el campo siguiente y los BCPs en
+ * uso estan en una tabla hash indexada por id.
  *
  */
 
@@ -28,30 +41,154 @@
 static void iniciar_tabla_proc(){
 	int i;
 
-	for (i=0; i<MAX_PROC; i++)
-		tabla_procs[i].estado=NO_USADA;
+	num_bloques_procs=0;
+	procs_libres=NULL;
+	for (i=0; i<TAM_HASH_PROCS; i++)
+		hash_procs[i]=NULL;
 }
 
 /*
- * Funci�n que busca una entrada libre en la tabla de procesos
+ * Funci�n que a�ade un bloque de BCPs a la tabla de procesos
  */
-static int buscar_BCP_libre(){
+static int crecer_tabla_proc(){
+	BCP *bloque;
 	int i;
 
-	for (i=0; i<MAX_PROC; i++)
-		if (tabla_procs[i].estado==NO_USADA)
-			return i;
-	return -1;
+	if (num_bloques_procs==MAX_BLOQUES_PROCS)
+		return -1;	/* tabla en su tamano maximo */
+	bloque=malloc(TAM_BLOQUE_PROCS*sizeof(BCP));
+	if (bloque==NULL)
+		return -1;
+
+	bloques_procs[num_bloques_procs++]=bloque;
+	for (i=0; i<TAM_BLOQUE_PROCS; i++) {
+		bloque[i].estado=NO_USADA;
+		bloque[i].lista=NULL;
+		bloque[i].siguiente=procs_libres;
+		procs_libres=&bloque[i];
+	}
+	return 0;
+}
+
+/*
+ * Funci�n que obtiene una entrada libre de la tabla de procesos,
+ * haciendola crecer si no queda ninguna
+ */
+static BCP * buscar_BCP_libre(){
+	BCP *proc;
+
+	if ((procs_libres==NULL) && (crecer_tabla_proc()<0))
+		return NULL;
+	proc=procs_libres;
+	procs_libres=proc->siguiente;
+	proc->siguiente=NULL;
+	return proc;
+}
+
+/*
+ * Funci�n que devuelve una entrada a la lista de libres
+ */
+static void liberar_BCP(BCP *proc){
+	proc->estado=NO_USADA;
+	proc->siguiente=procs_libres;
+	procs_libres=proc;
+}
+
+/*
+ * Funci�n que busca un BCP en uso por su id
+ */
+static BCP * buscar_BCP_por_id(int id){
+	BCP *proc;
+
+	for (proc=hash_procs[id%TAM_HASH_PROCS]; proc; proc=proc->sig_hash)
+		if (proc->id==id)
+			return proc;
+	return NULL;
+}
+
+/*
+ * Funcion que busca un BCP en uso por su numero de serie. Recorre toda
+ * la tabla hash, por lo que solo se usa en caminos poco frecuentes
+ */
+static BCP * buscar_BCP_por_serie(unsigned long serie){
+	BCP *proc;
+	int i;
+
+	for (i=0; i<TAM_HASH_PROCS; i++)
+		for (proc=hash_procs[i]; proc; proc=proc->sig_hash)
+			if (proc->serie==serie)
+				return proc;
+	return NULL;
+}
+
+/*
+ * Funci�n que asigna un id al BCP y lo incluye en la tabla hash. Los ids
+ * se asignan ciclicamente para no reutilizar de inmediato uno liberado
+ */
+static void asignar_id(BCP *proc){
+	int id;
+
+	do {
+		id=siguiente_id;
+		siguiente_id=(siguiente_id+1)%MAX_ID_PROC;
+	} while (buscar_BCP_por_id(id));
+
+	proc->id=id;
+	proc->sig_hash=hash_procs[id%TAM_HASH_PROCS];
+	hash_procs[id%TAM_HASH_PROCS]=proc;
+}
+
+/*
+ * Funci�n que saca un BCP de la tabla hash de ids
+ */
+static void retirar_id(BCP *proc){
+	BCP **pp=&hash_procs[proc->id%TAM_HASH_PROCS];
+
+	for ( ; *pp!=proc; pp=&(*pp)->sig_hash);
+	*pp=proc->sig_hash;
 }
 
 /*
  *
  * Funciones que facilitan el manejo de las listas de BCPs
  *	insertar_ultimo eliminar_primero eliminar_elem
+ *	insertar_plazo eliminar_plazo comprobar_lista
+ *
+ * Las listas son doblemente enlazadas e intrusivas: cada BCP guarda sus
+ * enlaces y la lista en la que esta, por lo que todas las operaciones
+ * salvo insertar_plazo son O(1). La lista de plazos (lista_bloqueados_dormir)
+ * usa sus propios enlaces para que un proceso pueda esperar a la vez a un
+ * mutex y a que venza un plazo.
  *
  * NOTA: PRIMERO SE DEBE LLAMAR A eliminar Y LUEGO A insertar
  */
 
+#ifdef DEPURAR_LISTAS
+/*
+ * Comprueba los invariantes de una lista, parando el sistema si no se
+ * cumplen. Solo se compila en modo depuracion.
+ */
+static void comprobar_lista(lista_BCPs *lista){
+	BCP *paux=lista->primero;
+
+	if ((lista->primero==NULL)!=(lista->ultimo==NULL))
+		panico_kernel("comprobar_lista: primero y ultimo inconsistentes");
+	if (paux && paux->anterior)
+		panico_kernel("comprobar_lista: el primero tiene anterior");
+	for ( ; paux; paux=paux->siguiente) {
+		if (paux->lista!=lista)
+			panico_kernel("comprobar_lista: BCP con lista propietaria erronea");
+		if (paux->siguiente && paux->siguiente->anterior!=paux)
+			panico_kernel("comprobar_lista: enlace anterior erroneo");
+		if (paux->siguiente==NULL && lista->ultimo!=paux)
+			panico_kernel("comprobar_lista: ultimo erroneo");
+	}
+}
+#define COMPROBAR_LISTA(lista) comprobar_lista(lista)
+#else
+#define COMPROBAR_LISTA(lista)
+#endif
+
 /*
  * Inserta un BCP al final de la lista.
  */
@@ -60,37 +197,126 @@ static void insertar_ultimo(lista_BCPs *lista, BCP * proc){
 		lista->primero= proc;
 	else
 		lista->ultimo->siguiente=proc;
+	proc->anterior=lista->ultimo;
 	lista->ultimo= proc;
 	proc->siguiente=NULL;
+	proc->lista=lista;
+	COMPROBAR_LISTA(lista);
 }
 
 /*
  * Elimina el primer BCP de la lista.
  */
 static void eliminar_primero(lista_BCPs *lista){
+	BCP *proc=lista->primero;
 
-	if (lista->ultimo==lista->primero)
+	if (lista->ultimo==proc)
 		lista->ultimo=NULL;
-	lista->primero=lista->primero->siguiente;
+	lista->primero=proc->siguiente;
+	if (lista->primero)
+		lista->primero->anterior=NULL;
+	proc->siguiente=proc->anterior=NULL;
+	proc->lista=NULL;
+	COMPROBAR_LISTA(lista);
 }
 
 /*
  * Elimina un determinado BCP de la lista.
  */
 static void eliminar_elem(lista_BCPs *lista, BCP * proc){
-	BCP *paux=lista->primero;
+	if (proc->lista!=lista)
+		return;		/* no esta en esta lista */
 
-	if (paux==proc)
-		eliminar_primero(lista);
-	else {
-		for ( ; ((paux) && (paux->siguiente!=proc));
-			paux=paux->siguiente);
-		if (paux) {
-			if (lista->ultimo==paux->siguiente)
-				lista->ultimo=paux;
-			paux->siguiente=paux->siguiente->siguiente;
-		}
-	}
+	if (proc->anterior)
+		proc->anterior->siguiente=proc->siguiente;
+	else
+		lista->primero=proc->siguiente;
+	if (proc->siguiente)
+		proc->siguiente->anterior=proc->anterior;
+	else
+		lista->ultimo=proc->anterior;
+	proc->siguiente=proc->anterior=NULL;
+	proc->lista=NULL;
+	COMPROBAR_LISTA(lista);
+}
+
+/*
+ * Inserta un BCP en la lista de plazos manteniendola ordenada por
+ * tick de despertar (a igual tick, por orden de llegada). Se recorre
+ * desde el final, ya que lo habitual es que despierte de los ultimos.
+ */
+static void insertar_plazo(BCP * proc){
+	lista_BCPs *lista=&lista_bloqueados_dormir;
+	BCP *paux=lista->ultimo;
+
+	for ( ; (paux) && (paux->despertar>proc->despertar);
+		paux=paux->ant_plazo);
+
+	/* proc va detras de paux (al principio si es NULL) */
+	proc->ant_plazo=paux;
+	proc->sig_plazo=paux ? paux->sig_plazo : lista->primero;
+	if (proc->sig_plazo)
+		proc->sig_plazo->ant_plazo=proc;
+	else
+		lista->ultimo=proc;
+	if (paux)
+		paux->sig_plazo=proc;
+	else
+		lista->primero=proc;
+	proc->en_plazos=1;
+}
+
+/*
+ * Elimina un BCP de la lista de plazos (si esta en ella).
+ */
+static void eliminar_plazo(BCP * proc){
+	lista_BCPs *lista=&lista_bloqueados_dormir;
+
+	if (!proc->en_plazos)
+		return;
+	if (proc->ant_plazo)
+		proc->ant_plazo->sig_plazo=proc->sig_plazo;
+	else
+		lista->primero=proc->sig_plazo;
+	if (proc->sig_plazo)
+		proc->sig_plazo->ant_plazo=proc->ant_plazo;
+	else
+		lista->ultimo=proc->ant_plazo;
+	proc->sig_plazo=proc->ant_plazo=NULL;
+	proc->en_plazos=0;
+}
+
+/*
+ *
+ * Funciones que manejan la cola de listos multinivel
+ *	insertar_listo eliminar_listo
+ *
+ */
+
+/*
+ * Inserta un BCP al final de la lista de listos de su prioridad. Si es
+ * mas prioritario que el proceso actual se fuerza una replanificacion.
+ */
+static void insertar_listo(BCP * proc){
+	insertar_ultimo(&lista_listos[proc->prioridad], proc);
+	mapa_listos|=(1U<<proc->prioridad);
+	pagina_info.num_listos++;
+
+	if (p_proc_actual && proc->prioridad<p_proc_actual->prioridad)
+		activar_int_SW();
+}
+
+/*
+ * Elimina un BCP de la lista de listos de su prioridad.
+ */
+static void eliminar_listo(BCP * proc){
+	lista_BCPs *lista=&lista_listos[proc->prioridad];
+
+	if (proc->lista==lista)
+		pagina_info.num_listos--;
+	eliminar_elem(lista, proc);
+	if (lista->primero==NULL)
+		mapa_listos&=~(1U<<proc->prioridad);
 }
 
 /*
@@ -100,12 +326,31 @@ static void eliminar_elem(lista_BCPs *lista, BCP * proc){
  */
 
 /*
- * Espera a que se produzca una interrupcion
+ * Devuelve el tick del proximo plazo de la lista de dormidos
+ * (el maximo representable si no hay ninguno)
+ */
+static unsigned long proximo_plazo(){
+	if (lista_bloqueados_dormir.primero==NULL)
+		return (unsigned long)-1;
+	return lista_bloqueados_dormir.primero->despertar;
+}
+
+/*
+ * Espera a que se produzca una interrupcion. Al entrar en reposo se
+ * calcula el proximo plazo para que int_reloj ignore los ticks previos.
  */
 static void espera_int(){
 	int nivel;
 
-	printk("-> NO HAY LISTOS. ESPERA INT\n");
+	if (!en_reposo) {
+		traza(TRAZA_INFO, TRAZA_PLANIF, "-> NO HAY LISTOS. ESPERA INT\n");
+		en_reposo=1;
+		plazo_reposo=proximo_plazo();
+		rellenar_pool_pilas();	/* aprovecha el reposo */
+	}
+
+	/* el reposo es el momento de volcar las trazas pendientes */
+	vaciar_trazas();
 
 	/* Baja al m�nimo el nivel de interrupci�n mientras espera */
 	nivel=fijar_nivel_int(NIVEL_1);
@@ -114,12 +359,26 @@ static void espera_int(){
 }
 
 /*
- * Funci�n de planificacion que implementa un algoritmo FIFO.
+ * Funci�n de planificacion por prioridades: devuelve el primer proceso
+ * del nivel mas prioritario no vacio (FIFO dentro de cada nivel).
  */
 static BCP * planificador(){
-	while (lista_listos.primero==NULL)
+	unsigned long suprimidos=ticks_suprimidos;
+	BCP *elegido;
+
+	while (mapa_listos==0)
 		espera_int();		/* No hay nada que hacer */
-	return lista_listos.primero;
+	if (en_reposo) {
+		en_reposo=0;
+		traza(TRAZA_INFO, TRAZA_PLANIF, "-> FIN ESPERA INT: %lu ticks suprimidos\n", ticks_suprimidos-suprimidos);
+	}
+	elegido=lista_listos[ffs(mapa_listos)-1].primero;
+
+	/* el elegido pasa a ser el proceso en ejecucion */
+	pagina_info.id_proceso=elegido->id;
+	pagina_info.ticks_rodaja=elegido->contadorTicks;
+	pagina_info.serie_proceso=elegido->serie;
+	return elegido;
 }
 
 /*
@@ -131,18 +390,26 @@ static BCP * planificador(){
 static void liberar_proceso(){
 	BCP * p_proc_anterior;
 
-	liberar_imagen(p_proc_actual->info_mem); /* liberar mapa */
+	/* cierre implicito de los mutex que siga teniendo abiertos */
+	cerrar_mutex_proceso();
+
+	/* el HAL apaga el sistema al liberar la ultima imagen */
+	if (--num_procesos==0)
+		mostrar_estadisticas();
+	soltar_imagen(p_proc_actual->imagen); /* liberar mapa */
 
 	p_proc_actual->estado=TERMINADO;
-	eliminar_primero(&lista_listos); /* proc. fuera de listos */
+	eliminar_listo(p_proc_actual); /* proc. fuera de listos */
+	retirar_id(p_proc_actual);
 
 	/* Realizar cambio de contexto */
 	p_proc_anterior=p_proc_actual;
 	p_proc_actual=planificador();
 
-	printk("-> C.CONTEXTO POR FIN: de %d a %d\n",p_proc_anterior->id, p_proc_actual->id);
+	traza(TRAZA_DEPURACION, TRAZA_PLANIF, "-> C.CONTEXTO POR FIN: de %d a %d\n",p_proc_anterior->id, p_proc_actual->id);
 
-	liberar_pila(p_proc_anterior->pila);
+	devolver_pila(p_proc_anterior->pila);
+	liberar_BCP(p_proc_anterior);
 	cambio_contexto(NULL, &(p_proc_actual->contexto_regs));
         return; /* no deber�a llegar aqui */
 }
@@ -164,10 +431,10 @@ static void liberar_proceso(){
 static void exc_arit(){
 
 	if (!viene_de_modo_usuario())
-		panico("exec_arit: excepcion aritmetica cuando estaba dentro del kernel");
+		panico_kernel("exec_arit: excepcion aritmetica cuando estaba dentro del kernel");
 
 
-	printk("-> EXCEPCION ARITMETICA EN PROC %d\n", p_proc_actual->id);
+	traza(TRAZA_AVISO, TRAZA_PROC, "-> EXCEPCION ARITMETICA EN PROC %d\n", p_proc_actual->id);
 	liberar_proceso();
 
         return; /* no deber�a llegar aqui */
@@ -178,11 +445,14 @@ static void exc_arit(){
  */
 static void exc_mem(){
 
-	if (!viene_de_modo_usuario())
-		panico("exec_mem: excepcion de memoria cuando estaba dentro del kernel");
+	/* dentro del kernel solo se admite si se accedia a un parametro del
+	   usuario: el error es del proceso y no del sistema */
+	if (!viene_de_modo_usuario() && !accediendo_parametro)
+		panico_kernel("exec_mem: excepcion de memoria cuando estaba dentro del kernel");
+	accediendo_parametro=0;
 
 
-	printk("-> EXCEPCION DE MEMORIA EN PROC %d\n", p_proc_actual->id);
+	traza(TRAZA_AVISO, TRAZA_PROC, "-> EXCEPCION DE MEMORIA EN PROC %d\n", p_proc_actual->id);
 	liberar_proceso();
 
         return; /* no deber�a llegar aqui */
@@ -195,7 +465,7 @@ static void int_terminal(){
 	char car;
 
 	car = leer_puerto(DIR_TERMINAL);
-	printk("-> TRATANDO INT. DE TERMINAL %c\n", car);
+	traza(TRAZA_DEPURACION, TRAZA_INT, "-> TRATANDO INT. DE TERMINAL %c\n", car);
 
         return;
 }
@@ -205,11 +475,33 @@ static void int_terminal(){
  */
 static void int_reloj(){
 
-	printk("-> TRATANDO INT. DE RELOJ\n");
-
 	int n_interrupcion = fijar_nivel_int(NIVEL_3);
+	ticks_totales++;
+	pagina_info.ticks=ticks_totales;
+
+#if MODO_SIN_TICKS
+	/* en reposo solo hay trabajo cuando vence el proximo plazo: el resto
+	   de ticks se suprimen (la cuenta de ticks_totales se mantiene) */
+	if (en_reposo && ticks_totales<plazo_reposo) {
+		ticks_suprimidos++;
+		fijar_nivel_int(n_interrupcion);
+		return;
+	}
+#endif
+
+	traza(TRAZA_DEPURACION, TRAZA_INT, "-> TRATANDO INT. DE RELOJ\n");
+
+	/* contabilidad del proceso en ejecucion (en reposo no hay ninguno) */
+	if (!en_reposo)
+	{
+		if (viene_de_modo_usuario())
+			p_proc_actual->ticks_usuario++;
+		else
+			p_proc_actual->ticks_sistema++;
+	}
+
 	/* procesos dormidos */
-	cuentaAtrasBloqueados();
+	despertarDormidos();
 
 	/* round robin */
 	actualizarTick();
@@ -226,8 +518,8 @@ static void tratar_llamsis(){
 	int nserv, res;
 
 	nserv=leer_registro(0);
-	if (nserv<NSERVICIOS)
-		res=(tabla_servicios[nserv].fservicio)();
+	if (nserv>=0 && nserv<NSERVICIOS)
+		res=ejecutar_servicio(nserv);
 	else
 		res=-1;		/* servicio no existente */
 	escribir_registro(0,res);
@@ -239,7 +531,7 @@ static void tratar_llamsis(){
  */
 static void int_sw(){
 
-	printk("-> TRATANDO INT. SW\n");
+	traza(TRAZA_DEPURACION, TRAZA_INT, "-> TRATANDO INT. SW\n");
 
 	/* round-robin */
 	tratarIntSW();
@@ -249,56 +541,89 @@ static void int_sw(){
 
 /*
  *
- * Funcion auxiliar que crea un proceso reservando sus recursos.
- * Usada por llamada crear_proceso.
+ * Funcion auxiliar que crea un proceso que ejecuta una imagen ya cargada
+ * a partir de pc_inicial, consumiendo una referencia de la imagen si
+ * tiene exito. Devuelve su BCP. Usada por crear_tarea y por las llamadas
+ * crear_procesos y crear_hilo.
  *
  */
-static int crear_tarea(char *prog){
-	void * imagen, *pc_inicial;
-	int error=0;
-	int proc, i;
+static BCP * crear_tarea_imagen(IMAGENptr imagen, void *pc_inicial){
+	int i;
 	BCP *p_proc;
 
-	proc=buscar_BCP_libre();
-	if (proc==-1)
-		return -1;	/* no hay entrada libre */
+	p_proc=buscar_BCP_libre();
+	if (p_proc==NULL)
+		return NULL;	/* no hay entrada libre */
 
 	/* A rellenar el BCP ... */
-	p_proc=&(tabla_procs[proc]);
-
-	/* crea la imagen de memoria leyendo ejecutable */
-	imagen=crear_imagen(prog, &pc_inicial);
-	if (imagen)
-	{
-		p_proc->info_mem=imagen;
-		p_proc->pila=crear_pila(TAM_PILA);
-		fijar_contexto_ini(p_proc->info_mem, p_proc->pila, TAM_PILA,
-			pc_inicial,
-			&(p_proc->contexto_regs));
-		p_proc->id=proc;
-		p_proc->estado=LISTO;
-
-		/* cosas añadidas */
-		/* llamada al sistema dormir */
-		p_proc->tiempo_dormir = 0;	
-		/* mutex */
-		p_proc->num_descriptores_abiertos = 0;
-		for (i = 0; i < NUM_MUT_PROC; i++)
-		{
-			p_proc->descriptores[i]=-1;
-		}
-		/* round-robin */
-		p_proc->contadorTicks = TICKS_POR_RODAJA;
-
-		
-		/* lo inserta al final de cola de listos */
-		insertar_ultimo(&lista_listos, p_proc);
-		error= 0;
+	p_proc->imagen=imagen;
+	p_proc->info_mem=imagen->mem;
+	p_proc->pila=obtener_pila();
+	fijar_contexto_ini(p_proc->info_mem, p_proc->pila, TAM_PILA,
+		pc_inicial,
+		&(p_proc->contexto_regs));
+	asignar_id(p_proc);
+	num_procesos++;
+	p_proc->estado=LISTO;
+
+	/* cosas añadidas */
+	/* llamada al sistema dormir */
+	p_proc->despertar = 0;
+	p_proc->sig_plazo = p_proc->ant_plazo = NULL;
+	p_proc->en_plazos = 0;
+	p_proc->plazo_vencido = 0;
+	/* mutex */
+	p_proc->num_descriptores_abiertos = 0;
+	for (i = 0; i < NUM_MUT_PROC; i++)
+	{
+		p_proc->descriptores[i]=NULL;
+		p_proc->lecturas[i]=0;
 	}
-	else
-		error= -1; /* fallo al crear imagen */
+	/* round-robin */
+	p_proc->contadorTicks = TICKS_POR_RODAJA;
+	/* prioridades */
+	p_proc->prioridad = PRIORIDAD_DEFECTO;
+	p_proc->prioridad_base = PRIORIDAD_DEFECTO;
+	p_proc->mutex_esperado = NULL;
+
+	/* contabilidad */
+	p_proc->ticks_usuario = 0;
+	p_proc->ticks_sistema = 0;
+	/* pagina de informacion */
+	p_proc->serie = siguiente_serie++;
+	/* anillo de llamadas */
+	p_proc->anillo = NULL;
+	/* estadisticas de llamadas */
+	memset(p_proc->estad_llamadas, 0, sizeof(p_proc->estad_llamadas));
+	/* hilos */
+	p_proc->funcion_hilo = NULL;
+	p_proc->arg_hilo = NULL;
+
+	/* lo inserta al final de cola de listos */
+	insertar_listo(p_proc);
+	return p_proc;
+}
+
+/*
+ *
+ * Funcion auxiliar que crea un proceso reservando sus recursos.
+ * Usada por llamada crear_proceso.
+ *
+ */
+static int crear_tarea(char *prog){
+	IMAGENptr imagen;
+
+	/* crea la imagen de memoria leyendo ejecutable (o reutiliza la cargada) */
+	imagen=obtener_imagen(prog);
+	if (imagen==NULL)
+		return -1; /* fallo al crear imagen */
 
-	return error;
+	if (crear_tarea_imagen(imagen, imagen->pc_inicial)==NULL)
+	{
+		soltar_imagen(imagen);
+		return -1;
+	}
+	return 0;
 }
 
 /*
@@ -316,7 +641,7 @@ int sis_crear_proceso(){
 	char *prog;
 	int res;
 
-	printk("-> PROC %d: CREAR PROCESO\n", p_proc_actual->id);
+	traza(TRAZA_INFO, TRAZA_PROC, "-> PROC %d: CREAR PROCESO\n", p_proc_actual->id);
 	prog=(char *)leer_registro(1);
 	res=crear_tarea(prog);
 	return res;
@@ -338,23 +663,55 @@ int sis_escribir()
 	return 0;
 }
 
+/*
+ * Tratamiento de llamada al sistema escribirv: escribe n segmentos con
+ * una sola llamada. Se valida la lista completa antes de escribir nada
+ * y cada segmento se pasa directamente a escribir_ker, sin copiarlo.
+ * Devuelve el numero de bytes escritos o -1 si la lista no es valida.
+ */
+int sis_escribirv()
+{
+	struct segmento *segs;
+	struct segmento lista[MAX_SEGMENTOS];
+	unsigned int n, i, total=0;
+
+	segs=(struct segmento *)leer_registro(1);
+	n=(unsigned int)leer_registro(2);
+
+	if (n>MAX_SEGMENTOS)
+		return -1;
+
+	/* si la lista no es accesible exc_mem aborta el proceso */
+	accediendo_parametro=1;
+	for (i=0; i<n; i++)
+		lista[i]=segs[i];
+	accediendo_parametro=0;
+
+	for (i=0; i<n; i++)
+	{
+		if (lista[i].longi>0 && lista[i].texto==NULL)
+			return -1;
+		if (total+lista[i].longi<total)
+			return -1;	/* desbordamiento de la longitud total */
+		total+=lista[i].longi;
+	}
+
+	/* tambien el contenido de los segmentos es memoria del usuario */
+	accediendo_parametro=1;
+	for (i=0; i<n; i++)
+		if (lista[i].longi>0)
+			escribir_ker(lista[i].texto, lista[i].longi);
+	accediendo_parametro=0;
+	return total;
+}
+
 /*
  * Tratamiento de llamada al sistema terminar_proceso. Llama a la
  * funcion auxiliar liberar_proceso
  */
 int sis_terminar_proceso(){
 	
-	/* comprobando si al proceso tiene mutex abiertos */
-	int i = 0;
-	while (p_proc_actual->num_descriptores_abiertos>0) {
-		if (p_proc_actual->descriptores[i]!=-1) {
-			//printk("Cierre implicito de mutexid: %d\n",i);
-			cerrar_mutex(p_proc_actual->descriptores[i]);
-		}
-		i++;
-	}
-	
-	printk("-> FIN PROCESO id: %d\n", p_proc_actual->id);
+	traza(TRAZA_INFO, TRAZA_PROC, "-> FIN PROCESO id: %d\n", p_proc_actual->id);
 
 	liberar_proceso();
 
@@ -374,17 +731,17 @@ int dormir(unsigned int segundos){
 	/* lectura de registro 1 */
 	unsigned int segs = (unsigned int)leer_registro(1);
 
-	/* guardar el nivel de interrupcion */
-	int n_interrupcion = fijar_nivel_int(NIVEL_1);
+	/* guardar el nivel de interrupcion, la lista de dormidos la usa el reloj */
+	int n_interrupcion = fijar_nivel_int(NIVEL_3);
 	BCPptr proceso_dormido = p_proc_actual;
 
 	/* actualizacion de estructura de datos */
-	proceso_dormido -> tiempo_dormir = segs*TICK;
+	proceso_dormido -> despertar = ticks_totales + segs*TICK;
 	proceso_dormido -> estado = BLOQUEADO;
 
 	/* cambio de lista de procesos */
-	eliminar_primero(&lista_listos);
-	insertar_ultimo(&lista_bloqueados_dormir,proceso_dormido);
+	eliminar_listo(proceso_dormido);
+	insertar_plazo(proceso_dormido);
 
 	/* usando el planificador se obtiene el proceso a ejecutar */
 	p_proc_actual=planificador();
@@ -396,358 +753,1636 @@ int dormir(unsigned int segundos){
 	return 0;
 }
 
-/* funcion auxiliar para la llamada dormir, actualiza los tiempos de los procesos dormidos */
-void cuentaAtrasBloqueados(){
+/* funcion auxiliar para la llamada dormir, despierta a los procesos cuyo plazo vence en este tick.
+   Al estar la lista ordenada por tick de despertar solo se tocan los que vencen */
+void despertarDormidos(){
 	
 	BCPptr auxiliar = lista_bloqueados_dormir.primero;			/* obtengo el primer proceso de la lista de bloqueados */
-	/* recorro la lista y actualizo los tiempos */
-	while(auxiliar != NULL){							/* mientas hay procesos en lista_bloqueados */
-		BCPptr siguiente = auxiliar->siguiente;			/* se obtiene el puntero al siguente elmento de la lista */
-		auxiliar->tiempo_dormir--;						/* se disminuye el contador de tiempo que le queda al proceso por dormir */
-		if(auxiliar->tiempo_dormir ==0){				/* si el tiempo de dormir se ha agotado */
+	while(auxiliar != NULL && auxiliar->despertar <= ticks_totales){	/* mientras haya procesos con el plazo vencido */
+		eliminar_plazo(auxiliar);						/* se elimina de la lista de plazos */
+		if (auxiliar->estado == BLOQUEADO)				/* si ya lo desperto un unlock solo se quita el plazo */
+		{
+			/* si esperaba un mutex se le saca de su lista, lock_temporizado
+			   ajusta el mutex al ver plazo_vencido */
+			if (auxiliar->lista != NULL)
+			{
+				eliminar_elem(auxiliar->lista, auxiliar);
+				auxiliar->plazo_vencido = 1;
+			}
 			auxiliar->estado = LISTO;					/* el proceso cambia de estado a LISTO */
-			eliminar_elem(&lista_bloqueados_dormir, auxiliar);	/* se elimina de la lista de bloqueados */
-			insertar_ultimo(&lista_listos, auxiliar);	/* y pasa a la lista de procesos listos */
+			insertar_listo(auxiliar);					/* y pasa a la lista de procesos listos */
 		}
-		auxiliar = siguiente;							/* a por el siguente elemento */
+		auxiliar = lista_bloqueados_dormir.primero;		/* a por el siguente elemento */
 	}
 }
 
 /* mutex */
 
-/* llamada al sistema para crear mutex */
-int crear_mutex(char *nombre, int tipo){
+/* nombres de las clases de objeto para las trazas */
+static char *nombre_clase[]={"Mutex", "Cond", "Cerrojo", "Semaforo"};
 
-	nombre = (char*) leer_registro(1);
-	tipo = (int) leer_registro(2);
-
-	int n_interrupcion, desc_lista_mutex, desc_libre_proc, mutex_creado;
-
-	n_interrupcion = fijar_nivel_int(NIVEL_1);
+/* crea un objeto de la clase indicada con el nombre ya copiado en nom y lo
+   abre en un descriptor del proceso actual. Se llama a nivel 3 y deja el
+   objeto en *pm; devuelve el descriptor o -1 */
+static int crear_objeto(char *nom, int clase, MUTEXptr *pm){
 
-	/* comprobacion de longitud de nombre */
-	if (strlen(nombre)>MAX_NOM_MUT)
-	{
-		printk("Error, nombre de mutex sobrepasa la logintud establecida\n");
-		fijar_nivel_int(n_interrupcion);
-		return -1;
-	}
+	int desc;
+	MUTEXptr m;
 
-	/* comprobacion de duplicidad de nombres */
-	if (buscarMutexPorNombre(nombre)!=-1)
+	/* comprobacion de duplicidad de nombres: todas las clases comparten
+	   el espacio de nombres */
+	if (buscar_mutex_por_nombre(nom)!=NULL)
 	{
-		printk("Error, mutex %s ya existe en el sistema\n",nombre);
-		fijar_nivel_int(n_interrupcion);
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, mutex %s ya existe en el sistema\n",nom);
 		return -1;
 	}
 
 	/* comprobacion de descriptores libres en el proceso actual */
-	desc_libre_proc = buscarDescriptorLibrePorceso();
-	if (desc_libre_proc==-1)
+	desc = buscarDescriptorLibrePorceso();
+	if (desc==-1)
 	{
-		printk("Error, el proceso id: %d no tiene descriptores libres\n",p_proc_actual->id);
-		fijar_nivel_int(n_interrupcion);
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, el proceso id: %d no tiene descriptores libres\n",p_proc_actual->id);
 		return -1;
 	}
 
-	/* comprobacion de hueco libre en lista mutex */
-	mutex_creado = 0;
-	while (mutex_creado==0)
+	/* con la tabla en su tamano maximo se espera a que se libere algun mutex */
+	while ((m=buscar_mutex_libre())==NULL)
 	{
-		desc_lista_mutex = buscarPosicionMutexLibre();
-		if (desc_lista_mutex==-1)
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, alcanzado maximo de mutex creados en el sistema\n");
+		traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Bloqueando proceso id: %d\n",p_proc_actual->id);
+		bloquear_proceso_actual(&lista_bloqueados_mutex);
+
+		/* mientras estaba bloqueado otro proceso ha podido crearlo */
+		if (buscar_mutex_por_nombre(nom)!=NULL)
 		{
-			mutex_creado=0;
-			printk("Error, alcanzado maximo de mutex creados en el sistema\n");
-			printk("Bloqueando proceso id: %d\n",p_proc_actual->id);
-			contador_lista_bloqueados_mutex++;
-			BCPptr p_proc_bloqueado = p_proc_actual;
-			p_proc_bloqueado->estado = BLOQUEADO;
-			eliminar_primero(&lista_listos);
-			insertar_ultimo(&lista_bloqueados_mutex,p_proc_bloqueado);
-			p_proc_actual = planificador();
-			printk("C.CONTEXTO POR BLOQUEO de %d a %d\n",p_proc_bloqueado->id,p_proc_actual->id);
-			cambio_contexto(&(p_proc_bloqueado->contexto_regs),&(p_proc_actual->contexto_regs));
+			traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, mutex %s ya existe en el sistema\n",nom);
+			return -1;
 		}
-
-		/* si ha pasado todas las pruebas y no se ha bloqueado */
-		/* crea el mutex */
-		MUTEXptr m = &lista_mutex[desc_lista_mutex];
-		strcpy(m->nombre,nombre);
-		m->tipo=tipo;
-		m->estado = OCUPADO;
-		contador_lista_mutex++;
-		/* abre el mutex */
-		p_proc_actual->descriptores[desc_libre_proc]=desc_lista_mutex;
-		p_proc_actual->num_descriptores_abiertos++;
-		printk("Mutex %s CREADO y ABIERTO\n",m->nombre);
-		mutex_creado=1;
 	}
-	
-	fijar_nivel_int(n_interrupcion);
-	return desc_libre_proc;
-}
 
-/* llamada al sistema para abrir mutex */
-int abrir_mutex(char *nombre){
+	/* crea el objeto */
+	strcpy(m->nombre,nom);
+	m->clase=clase;
+	m->palabra.estado=0;
+	m->palabra.contador=0;
+	m->palabra.tipo=NO_RECURSIVO;
+	memset(&m->estad, 0, sizeof(m->estad));
+	m->estado=OCUPADO;
+	insertar_mutex_por_nombre(m);
+
+	/* lo abre */
+	m->num_abiertos=1;
+	p_proc_actual->descriptores[desc]=m;
+	p_proc_actual->num_descriptores_abiertos++;
+	traza(TRAZA_INFO, TRAZA_MUTEX, "%s %s CREADO y ABIERTO\n",nombre_clase[clase],m->nombre);
 
-	nombre = (char*) leer_registro(1);
-	int n_interrupcion,pos_lista_mutex, desc_libre_proc;
+	*pm=m;
+	return desc;
+}
+
+/* abre en un descriptor del proceso actual el objeto de la clase indicada
+   con el nombre nom. Se llama a nivel 3; devuelve el descriptor o -1 */
+static int abrir_objeto(char *nom, int clase, MUTEXptr *pm){
 
-	n_interrupcion = fijar_nivel_int(NIVEL_1);
+	int desc;
+	MUTEXptr m;
 
-	/* busqueda de mutex por su nombre */
-	pos_lista_mutex = buscarMutexPorNombre(nombre);
-	if (pos_lista_mutex==-1)
+	/* busqueda por nombre */
+	m = buscar_mutex_por_nombre(nom);
+	if (m==NULL || m->clase!=clase)
 	{
-		printk("Error, mutex %s no encontrado\n",nombre);
-		fijar_nivel_int(n_interrupcion);
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, %s %s no encontrado\n",clase==CLASE_MUTEX ? "mutex" : nombre_clase[clase],nom);
 		return -1;
 	}
 
-	/* comprobacion de mutex disponibles en proceso actual */
-	desc_libre_proc = buscarDescriptorLibrePorceso();
-	if (desc_libre_proc==-1)
+	/* comprobacion de descriptores libres en proceso actual */
+	desc = buscarDescriptorLibrePorceso();
+	if (desc==-1)
 	{
-		printk("Error, el proceso id: %d no tiene descriptores libres\n",p_proc_actual->id);
-		fijar_nivel_int(n_interrupcion);
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, el proceso id: %d no tiene descriptores libres\n",p_proc_actual->id);
 		return -1;
 	}
 
-	p_proc_actual->descriptores[desc_libre_proc] = pos_lista_mutex;
+	m->num_abiertos++;
+	p_proc_actual->descriptores[desc] = m;
 	p_proc_actual->num_descriptores_abiertos++;
-	printk("Mutex %s ABIERTO\n",nombre);
-	fijar_nivel_int(n_interrupcion);
-
-	return desc_libre_proc;
+	traza(TRAZA_INFO, TRAZA_MUTEX, "%s %s ABIERTO\n",nombre_clase[clase],nom);
 
+	*pm=m;
+	return desc;
 }
 
-/* llamada al sistema para boquear mutex */
-int lock(unsigned int mutexid){
+/* llamada al sistema para crear mutex. Si palabra no es NULL se deja en
+   ella la direccion de la palabra del mutex, para que el proceso pueda
+   bloquearlo y desbloquearlo sin llamadas mientras no haya contienda */
+int crear_mutex(char *nombre, int tipo, struct palabra_mutex **palabra){
 
-	int n_interrupcion, desc_proc, pos_lista_mutex, lock;
-	int *retorno;
-	unsigned int m_id = (unsigned int) leer_registro(1);
-	if (m_id<NUM_MUT)
-	{
-		mutexid=m_id;
-	}
+	char nom[MAX_NOM_MUT+1];
+	int n_interrupcion, desc;
+	MUTEXptr m;
 
-	n_interrupcion = fijar_nivel_int(NIVEL_1);
+	nombre = (char*) leer_registro(1);
+	tipo = (int) leer_registro(2);
+	palabra = (struct palabra_mutex **) leer_registro(3);
 
-	retorno = buscarMutexPorID((int)mutexid);
-	desc_proc = *retorno;
-	pos_lista_mutex = *(retorno+1);
-	if (desc_proc==-1)
+	/* comprobacion de longitud de nombre */
+	if (leer_nombre_mutex(nombre, nom)<0)
 	{
-		printk("Error, mutex con mutexid: %d no encontrado\n",mutexid);
-		fijar_nivel_int(n_interrupcion);
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, nombre de mutex sobrepasa la logintud establecida\n");
 		return -1;
 	}
-	
-	MUTEXptr m = &lista_mutex[pos_lista_mutex];
 
-	//printk("Mutex %s encontrado | num_bloqueos: %d, id propietario: %d\n",m->nombre,m->contador_bloqueos,m->id_proceso_propietario);
-	lock=0;
-	while (lock==0)
-	{
-		if (m->id_proceso_propietario==-1 && m->contador_bloqueos==0)
-		{
-			m->contador_bloqueos++;
-			m->id_proceso_propietario=p_proc_actual->id;
-			m->mutex_lock=LOCKED;
-
-			printk("Mutex %s BLOQUEADO\n",m->nombre);
-			
-			fijar_nivel_int(n_interrupcion);
-			return desc_proc;
-		}
-		if (m->id_proceso_propietario==p_proc_actual->id)
-		{
-			if (m->mutex_lock==LOCKED && m->tipo==RECURSIVO)
-			{
-				lock=1;
-				m->contador_bloqueos++;
-				printk("Mutex RECURSIVO %s BLOQUEADO\n",m->nombre);
-				return desc_proc;
-			} else if (m->mutex_lock==LOCKED)
-			{
-				printk("Error, intento de bloquear mutex %s ya bloqueado y de tipo NO RECURSIVO\n",m->nombre);
-				fijar_nivel_int(n_interrupcion);
-				return -1;
-			}	
-		}
-		
-		/* si llega hasta aqui esque proceso actual no es propietario del mutex y sera bloqueado*/
-		//printk("Error, proceso id: %d no es propietario de mutex %s, id propietario real: %d\n",p_proc_actual->id,m->nombre,m->id_proceso_propietario);
-		//printk("Bloqueando proceso id: %d\n",p_proc_actual->id);
-		lock=0;
-		m->num_procesos_esperando++;
-		BCPptr p_proc_bloqueado = p_proc_actual;
-		p_proc_bloqueado->estado = BLOQUEADO;
-		eliminar_primero(&lista_listos);
-		insertar_ultimo(&(m->lista_procesos_esperando),p_proc_bloqueado);
-		p_proc_actual = planificador();
-		printk("C.CONTEXTO POR BLOQUEO de %d a %d\n",p_proc_bloqueado->id,p_proc_actual->id);
-		cambio_contexto(&(p_proc_bloqueado->contexto_regs),&(p_proc_actual->contexto_regs));
-	}
-	
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	desc = crear_objeto(nom, CLASE_MUTEX, &m);
+	if (desc>=0)
+		m->palabra.tipo=tipo;
 	fijar_nivel_int(n_interrupcion);
-	return -1;
+
+	if (desc>=0)
+		dar_palabra_mutex(palabra, m);
+	return desc;
 }
 
-/* llamada al sistema para desbloquear mutex */
-int unlock(unsigned int mutexid){
-	int n_interrupcion, desc_proc, pos_lista_mutex;
-	int *retorno;
-	unsigned int m_id = (unsigned int) leer_registro(1);
+/* llamada al sistema para abrir mutex, palabra como en crear_mutex */
+int abrir_mutex(char *nombre, struct palabra_mutex **palabra){
+
+	char nom[MAX_NOM_MUT+1];
+	int n_interrupcion, desc;
+	MUTEXptr m;
+
+	nombre = (char*) leer_registro(1);
+	palabra = (struct palabra_mutex **) leer_registro(2);
 
-	if (m_id<NUM_MUT)
+	if (leer_nombre_mutex(nombre, nom)<0)
 	{
-		mutexid=m_id;
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, nombre de mutex sobrepasa la logintud establecida\n");
+		return -1;
 	}
 
-	n_interrupcion = fijar_nivel_int(NIVEL_1);
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	desc = abrir_objeto(nom, CLASE_MUTEX, &m);
+	fijar_nivel_int(n_interrupcion);
+
+	if (desc>=0)
+		dar_palabra_mutex(palabra, m);
+	return desc;
+}
+
+/* saca de la espera de m al primer proceso y lo deja listo para que
+   vuelva a intentar bloquearlo. Devuelve NULL si no esperaba nadie */
+static BCPptr despertar_esperando(MUTEXptr m){
+	BCPptr p_proc_bloqueado;
 
-	retorno = buscarMutexPorID((int)mutexid);
-	desc_proc = *retorno;
-	pos_lista_mutex = *(retorno+1);
-	if (desc_proc==-1)
+	if ((p_proc_bloqueado=m->lista_procesos_esperando.primero)!=NULL)
 	{
-		printk("Error, mutex con mutexid: %d no encontrado\n",mutexid);
-		fijar_nivel_int(n_interrupcion);
-		return -1;
+		m->num_procesos_esperando--;
+		eliminar_primero(&(m->lista_procesos_esperando));
+		p_proc_bloqueado->estado = LISTO;
+		insertar_listo(p_proc_bloqueado);
+		traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Proceso id: %d DESBLOQUEADO\n",p_proc_bloqueado->id);
 	}
-	
-	MUTEXptr m = &lista_mutex[pos_lista_mutex];
+	return p_proc_bloqueado;
+}
+
+/* el proceso actual deja de esperar a m sin conseguirlo. Si lo desperto
+   un unlock, que borra el bit de espera, otro pudo bloquearlo despues sin
+   el y su unlock no entraria al kernel: con procesos aun en la lista se
+   vuelve a activar el bit o, si el mutex esta libre, se pasa el despertar
+   al siguiente para que nadie quede esperando para siempre */
+static void abandonar_espera(MUTEXptr m){
+
+	p_proc_actual->mutex_esperado=NULL;
+	eliminar_plazo(p_proc_actual);
+	if (m->lista_procesos_esperando.primero==NULL)
+		return;
+	if (!MUTEX_LIBRE(m))
+		m->palabra.estado|=MUTEX_ESPERANDO;
+	else
+		despertar_esperando(m);
+}
 
-	//printk("Mutex %s encontrado | num_bloqueos: %d, id propietario: %d\n",m->nombre,m->contador_bloqueos,m->id_proceso_propietario);
+/* bloquea el mutex para el proceso actual esperando mientras lo tenga
+   otro, como mucho ticks si temporizado. Se llama a nivel 3; devuelve -1
+   si ya lo tiene y no es recursivo y ERROR_PLAZO si vence el plazo */
+static int adquirir_mutex(MUTEXptr m, int temporizado, unsigned int ticks){
 
-	if (m->mutex_lock==LOCKED)
+	/* mientras lo tenga otro proceso se espera: al despertar se reintenta.
+	   El bit de espera obliga al propietario a llamar a unlock para despertarlo */
+	if (!MUTEX_LIBRE(m) && PROPIETARIO_MUTEX(m)!=p_proc_actual->id)
 	{
-		//printk("Mutex %s esta bloqueado, desbloqueando\n",m->nombre);
-		m->contador_bloqueos--;
-		//printk("Contador de bloqueos decrementado: %d, mutex %s\n",m->contador_bloqueos,m->nombre);
-		if (m->contador_bloqueos==0)
+		if (temporizado && ticks==0)
+			return ERROR_PLAZO;
+
+		/* el proceso queda en la lista de plazos mientras espera */
+		if (temporizado)
 		{
-			m->mutex_lock=UNLOCKED;
-			m->id_proceso_propietario=-1;
-			printk("Mutex %s DESBLOQUEADO\n",m->nombre);
+			p_proc_actual->despertar=ticks_totales+ticks;
+			p_proc_actual->plazo_vencido=0;
+			insertar_plazo(p_proc_actual);
+		}
+
+		m->estad.esperas++;
+		estad_mutex_total.esperas++;
+		p_proc_actual->mutex_esperado=m;
+		do {
+			/* despertado por un unlock y adelantado por otro proceso: si el
+			   plazo ya ha vencido (el reloj solo lo quito de la lista de
+			   plazos) no se vuelve a esperar */
+			if (temporizado && (!p_proc_actual->en_plazos ||
+				ticks_totales>=p_proc_actual->despertar))
+			{
+				abandonar_espera(m);
+				traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Plazo vencido esperando mutex %s\n",m->nombre);
+				return ERROR_PLAZO;
+			}
+
+			/* el propietario puede estar esperando, directa o indirectamente,
+			   a un mutex del proceso actual */
+			if (hay_interbloqueo(m))
+			{
+				m->estad.interbloqueos++;
+				estad_mutex_total.interbloqueos++;
+				if (DETECCION_INTERBLOQUEOS==INTERBLOQUEO_FALLAR)
+				{
+					abandonar_espera(m);
+					return ERROR_INTERBLOQUEO;
+				}
+			}
+			m->palabra.estado|=MUTEX_ESPERANDO;
+			m->num_procesos_esperando++;
+			bloquear_proceso_actual(&(m->lista_procesos_esperando));
 
-			if (m->num_procesos_esperando>0)
+			/* el reloj lo ha sacado de la lista de espera: el propietario
+			   deja de heredar de el */
+			if (p_proc_actual->plazo_vencido)
 			{
+				p_proc_actual->mutex_esperado=NULL;
 				m->num_procesos_esperando--;
-				BCPptr p_proc_bloqueado = m->lista_procesos_esperando.primero;
-				p_proc_bloqueado->estado = LISTO;
-				eliminar_primero(&(m->lista_procesos_esperando));
-				insertar_ultimo(&lista_listos,p_proc_bloqueado);
-				printk("Proceso id: %d DESBLOQUEADO\n",p_proc_bloqueado->id);
+				if (m->lista_procesos_esperando.primero==NULL)
+					m->palabra.estado&=~MUTEX_ESPERANDO;
+				propagar_prioridad(propietario_mutex(m));
+				traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Plazo vencido esperando mutex %s\n",m->nombre);
+				return ERROR_PLAZO;
+			}
+
+			/* con TRASPASO el unlock ya lo ha hecho propietario */
+			if (PROPIETARIO_MUTEX(m)==p_proc_actual->id)
+			{
+				p_proc_actual->mutex_esperado=NULL;
+				eliminar_plazo(p_proc_actual);
+				return 0;
 			}
+			if (!MUTEX_LIBRE(m))
+			{
+				m->estad.fallos_readquisicion++;
+				estad_mutex_total.fallos_readquisicion++;
+			}
+		} while (!MUTEX_LIBRE(m));
+
+		p_proc_actual->mutex_esperado=NULL;
+		eliminar_plazo(p_proc_actual);
+	}
 
-			fijar_nivel_int(n_interrupcion);
-			return desc_proc;
+	if (!MUTEX_LIBRE(m))
+	{
+		/* el propietario solo puede volver a bloquearlo si es recursivo */
+		if (!(m->palabra.tipo&RECURSIVO))
+		{
+			traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, intento de bloquear mutex %s ya bloqueado y de tipo NO RECURSIVO\n",m->nombre);
+			return -1;
 		}
-		
-	} else { 	/* si el mutex no esta bloqueado el intento de desbloquearlo producira un error */
-		printk("Error, intento de desbloquear mutex %s no bloqueado\n",m->nombre);
+		m->palabra.contador++;
+		traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Mutex RECURSIVO %s BLOQUEADO\n",m->nombre);
+	}
+	else
+	{
+		/* si quedan procesos esperando se mantiene el bit de espera */
+		m->palabra.estado=(p_proc_actual->id+1) |
+			(m->lista_procesos_esperando.primero ? MUTEX_ESPERANDO : 0);
+		m->palabra.contador=1;
+		traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Mutex %s BLOQUEADO\n",m->nombre);
+	}
+	return 0;
+}
+
+/* llamada al sistema para boquear mutex. Los procesos que usan la palabra
+   del mutex solo la invocan si esta ocupado por otro (o si lo vuelven a
+   bloquear siendo ya propietarios): es el camino lento con espera */
+int lock(unsigned int mutexid){
+
+	int n_interrupcion, res;
+	MUTEXptr m;
+
+	mutexid = (unsigned int) leer_registro(1);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	m = mutex_de_descriptor(mutexid);
+	if (m==NULL)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, mutex con mutexid: %d no encontrado\n",mutexid);
 		fijar_nivel_int(n_interrupcion);
 		return -1;
 	}
-	
 
+	res = adquirir_mutex(m, 0, 0);
 	fijar_nivel_int(n_interrupcion);
-	return 0;
+	return res;
 }
 
-/* llamada al sistema para cerrar mutex */
-int cerrar_mutex(unsigned int mutexid){
+/* llamada al sistema para bloquear mutex esperando como mucho ticks
+   (con 0 no espera). Devuelve ERROR_PLAZO si vence el plazo */
+int lock_temporizado(unsigned int mutexid, unsigned int ticks){
+
+	int n_interrupcion, res;
+	MUTEXptr m;
 
-	int n_interrupcion, desc_proc, pos_lista_mutex;
-	int *retorno;
-	unsigned int m_id = (unsigned int) leer_registro(1);
+	mutexid = (unsigned int) leer_registro(1);
+	ticks = (unsigned int) leer_registro(2);
 
-	if (m_id<NUM_MUT)
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	m = mutex_de_descriptor(mutexid);
+	if (m==NULL)
 	{
-		mutexid=m_id;
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, mutex con mutexid: %d no encontrado\n",mutexid);
+		fijar_nivel_int(n_interrupcion);
+		return -1;
 	}
 
-	n_interrupcion = fijar_nivel_int(NIVEL_1);
-	//printk("MUTEXID: %d\n",mutexid);
-	retorno = buscarMutexPorID((int) mutexid);
-	desc_proc = *retorno;
-	pos_lista_mutex = *(retorno+1);
-	if (desc_proc==-1)
+	res = adquirir_mutex(m, 1, ticks);
+	fijar_nivel_int(n_interrupcion);
+	return res;
+}
+
+/* llamada al sistema para desbloquear mutex. Los procesos que usan la
+   palabra del mutex solo la invocan si hay procesos esperando */
+int unlock(unsigned int mutexid){
+
+	int n_interrupcion;
+	MUTEXptr m;
+
+	mutexid = (unsigned int) leer_registro(1);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	m = mutex_de_descriptor(mutexid);
+	if (m==NULL)
 	{
-		printk("Error, mutex con mutexid: %d no encontrado\n",mutexid);
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, mutex con mutexid: %d no encontrado\n",mutexid);
 		fijar_nivel_int(n_interrupcion);
 		return -1;
 	}
-	//pos_lista_mutex = p_proc_actual->descriptores[desc_proc];
-	MUTEXptr m = &lista_mutex[pos_lista_mutex];
-	//printk("Mutex %s encontrado\n",m->nombre);
 
-	while (m->mutex_lock==LOCKED)
+	/* solo el propietario puede desbloquearlo */
+	if (m->palabra.estado==0 || PROPIETARIO_MUTEX(m)!=p_proc_actual->id)
 	{
-		unlock(mutexid);
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, intento de desbloquear mutex %s no bloqueado por el proceso\n",m->nombre);
+		fijar_nivel_int(n_interrupcion);
+		return -1;
 	}
-	
-	m->estado = LIBRE;
-	m->contador_bloqueos=0;
-	m->num_procesos_esperando=0;
-	p_proc_actual->descriptores[desc_proc]=-1;
-	p_proc_actual->num_descriptores_abiertos--;
-	contador_lista_mutex--;
-	printk("Mutex %s CERRADO\n",m->nombre);
 
-	if (contador_lista_bloqueados_mutex>0)
+	if (--m->palabra.contador==0)
+		liberar_lock(m);
+
+	fijar_nivel_int(n_interrupcion);
+	return 0;
+}
+
+/* llamada al sistema para cerrar mutex */
+int cerrar_mutex(unsigned int mutexid){
+
+	int n_interrupcion, res;
+
+	mutexid = (unsigned int) leer_registro(1);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	res = -1;
+	if (mutex_de_descriptor(mutexid)!=NULL)
+		res = cerrar_descriptor(mutexid);
+	if (res<0)
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, mutex con mutexid: %d no encontrado\n",mutexid);
+	fijar_nivel_int(n_interrupcion);
+
+	return res;
+}
+
+/* llamada al sistema que copia en *estad los contadores de un mutex abierto */
+int estad_mutex(unsigned int mutexid, struct estad_mutex *estad){
+
+	int n_interrupcion;
+	struct estad_mutex e;
+	MUTEXptr m;
+
+	mutexid = (unsigned int) leer_registro(1);
+	estad = (struct estad_mutex *) leer_registro(2);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	if ((m=mutex_de_descriptor(mutexid))==NULL)
+	{
+		fijar_nivel_int(n_interrupcion);
+		return -1;
+	}
+	e=m->estad;
+	fijar_nivel_int(n_interrupcion);
+
+	/* si la direccion no es valida exc_mem aborta el proceso */
+	accediendo_parametro=1;
+	*estad=e;
+	accediendo_parametro=0;
+	return 0;
+}
+
+/* variables condicion */
+
+/* llamada al sistema para crear una variable condicion. Comparte con los
+   mutex el espacio de nombres y los descriptores del proceso */
+int crear_cond(char *nombre){
+
+	char nom[MAX_NOM_MUT+1];
+	int n_interrupcion, desc;
+	MUTEXptr c;
+
+	nombre = (char*) leer_registro(1);
+
+	if (leer_nombre_mutex(nombre, nom)<0)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, nombre de condicion sobrepasa la logintud establecida\n");
+		return -1;
+	}
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	desc = crear_objeto(nom, CLASE_COND, &c);
+	fijar_nivel_int(n_interrupcion);
+	return desc;
+}
+
+/* llamada al sistema para abrir una variable condicion */
+int abrir_cond(char *nombre){
+
+	char nom[MAX_NOM_MUT+1];
+	int n_interrupcion, desc;
+	MUTEXptr c;
+
+	nombre = (char*) leer_registro(1);
+
+	if (leer_nombre_mutex(nombre, nom)<0)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, nombre de condicion sobrepasa la logintud establecida\n");
+		return -1;
+	}
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	desc = abrir_objeto(nom, CLASE_COND, &c);
+	fijar_nivel_int(n_interrupcion);
+	return desc;
+}
+
+/* llamada al sistema que libera el mutex (que debe tener el proceso),
+   espera a que se senale la condicion y vuelve a bloquear el mutex. Al ir
+   todo a nivel 3 no se puede perder una senal entre liberar y esperar */
+int esperar_cond(unsigned int condid, unsigned int mutexid){
+
+	int n_interrupcion, contador, res;
+	MUTEXptr c, m;
+
+	condid = (unsigned int) leer_registro(1);
+	mutexid = (unsigned int) leer_registro(2);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	c = cond_de_descriptor(condid);
+	m = mutex_de_descriptor(mutexid);
+	if (c==NULL || m==NULL)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, condicion %d o mutex %d no encontrados\n",condid,mutexid);
+		fijar_nivel_int(n_interrupcion);
+		return -1;
+	}
+	if (m->palabra.estado==0 || PROPIETARIO_MUTEX(m)!=p_proc_actual->id)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, espera en condicion %s sin tener el mutex %s\n",c->nombre,m->nombre);
+		fijar_nivel_int(n_interrupcion);
+		return -1;
+	}
+
+	/* se suelta del todo aunque sea recursivo y luego se restaura */
+	contador=m->palabra.contador;
+	liberar_lock(m);
+
+	c->num_procesos_esperando++;
+	bloquear_proceso_actual(&(c->lista_procesos_esperando));
+
+	/* si no lo recupera (interbloqueo) el proceso queda sin el mutex */
+	res = adquirir_mutex(m, 0, 0);
+	if (res==0)
+		m->palabra.contador=contador;
+
+	fijar_nivel_int(n_interrupcion);
+	return res;
+}
+
+/* despierta hasta max procesos que esperan en la condicion c */
+static void despertar_cond(MUTEXptr c, int max){
+	BCPptr p_proc_bloqueado;
+
+	while (max-- > 0 && (p_proc_bloqueado=c->lista_procesos_esperando.primero)!=NULL)
+	{
+		c->num_procesos_esperando--;
+		eliminar_primero(&(c->lista_procesos_esperando));
+		p_proc_bloqueado->estado = LISTO;
+		insertar_listo(p_proc_bloqueado);
+		traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Proceso id: %d DESPERTADO por condicion %s\n",p_proc_bloqueado->id,c->nombre);
+	}
+}
+
+/* servicio comun de senalar_cond y difundir_cond */
+static int senalar(unsigned int condid, int max){
+
+	int n_interrupcion;
+	MUTEXptr c;
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	c = cond_de_descriptor(condid);
+	if (c==NULL)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, condicion con condid: %d no encontrada\n",condid);
+		fijar_nivel_int(n_interrupcion);
+		return -1;
+	}
+	despertar_cond(c, max);
+	fijar_nivel_int(n_interrupcion);
+	return 0;
+}
+
+/* llamada al sistema que despierta al primer proceso que espera en la condicion */
+int senalar_cond(unsigned int condid){
+	condid = (unsigned int) leer_registro(1);
+	return senalar(condid, 1);
+}
+
+/* llamada al sistema que despierta a todos los procesos que esperan en la condicion */
+int difundir_cond(unsigned int condid){
+	condid = (unsigned int) leer_registro(1);
+	return senalar(condid, MAX_PROC);
+}
+
+/* llamada al sistema para cerrar una variable condicion */
+int cerrar_cond(unsigned int condid){
+
+	int n_interrupcion, res;
+
+	condid = (unsigned int) leer_registro(1);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	res = -1;
+	if (cond_de_descriptor(condid)!=NULL)
+		res = cerrar_descriptor(condid);
+	if (res<0)
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, condicion con condid: %d no encontrada\n",condid);
+	fijar_nivel_int(n_interrupcion);
+
+	return res;
+}
+
+/* cerrojos de lectura/escritura */
+
+/* saca al primer proceso de la lista y lo pasa a listo */
+static BCPptr despertar_primero(lista_BCPs *lista){
+	BCPptr p_proc_bloqueado=lista->primero;
+
+	eliminar_primero(lista);
+	p_proc_bloqueado->estado = LISTO;
+	insertar_listo(p_proc_bloqueado);
+	return p_proc_bloqueado;
+}
+
+/* cede el cerrojo tras quedar libre: con preferencia al primer escritor
+   que espera y, si no hay ninguno, a todos los lectores de una vez. Los
+   despertados salen de su lock ya con el cerrojo concedido */
+static void conceder_rw(MUTEXptr rw){
+	BCPptr p_proc_bloqueado;
+
+	if (rw->palabra.estado!=0 || rw->lectores>0)
+		return;
+
+	if (rw->lista_procesos_esperando.primero!=NULL)
+	{
+		rw->num_procesos_esperando--;
+		p_proc_bloqueado=despertar_primero(&(rw->lista_procesos_esperando));
+		rw->palabra.estado=p_proc_bloqueado->id+1;
+		traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Cerrojo %s concedido en escritura a %d\n",rw->nombre,p_proc_bloqueado->id);
+		return;
+	}
+
+	while (rw->lista_lectores.primero!=NULL)
+	{
+		rw->num_lectores_esperando--;
+		despertar_primero(&(rw->lista_lectores));
+		rw->lectores++;
+	}
+	traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Cerrojo %s concedido en lectura a %d procesos\n",rw->nombre,rw->lectores);
+}
+
+/* suelta lo que el proceso actual tenga del cerrojo abierto en desc.
+   Devuelve -1 si no tenia nada */
+static int soltar_rw(MUTEXptr rw, unsigned int desc){
+
+	if (rw->palabra.estado!=0 && PROPIETARIO_MUTEX(rw)==p_proc_actual->id)
+		rw->palabra.estado=0;
+	else if (p_proc_actual->lecturas[desc]>0)
+	{
+		p_proc_actual->lecturas[desc]--;
+		rw->lectores--;
+	}
+	else
+		return -1;
+
+	conceder_rw(rw);
+	return 0;
+}
+
+/* llamada al sistema para crear un cerrojo de lectura/escritura. Comparte
+   con los mutex el espacio de nombres y los descriptores del proceso */
+int crear_rw(char *nombre){
+
+	char nom[MAX_NOM_MUT+1];
+	int n_interrupcion, desc;
+	MUTEXptr rw;
+
+	nombre = (char*) leer_registro(1);
+
+	if (leer_nombre_mutex(nombre, nom)<0)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, nombre de cerrojo sobrepasa la logintud establecida\n");
+		return -1;
+	}
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	desc = crear_objeto(nom, CLASE_RW, &rw);
+	fijar_nivel_int(n_interrupcion);
+	return desc;
+}
+
+/* llamada al sistema para abrir un cerrojo de lectura/escritura */
+int abrir_rw(char *nombre){
+
+	char nom[MAX_NOM_MUT+1];
+	int n_interrupcion, desc;
+	MUTEXptr rw;
+
+	nombre = (char*) leer_registro(1);
+
+	if (leer_nombre_mutex(nombre, nom)<0)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, nombre de cerrojo sobrepasa la logintud establecida\n");
+		return -1;
+	}
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	desc = abrir_objeto(nom, CLASE_RW, &rw);
+	fijar_nivel_int(n_interrupcion);
+	return desc;
+}
+
+/* llamada al sistema para bloquear en lectura. Con preferencia de
+   escritura un lector nuevo espera si hay algun escritor esperando; uno
+   que ya lo tiene en lectura entra sin esperar, ya que el escritor le
+   espera a el */
+int lock_lectura(unsigned int rwid){
+
+	int n_interrupcion;
+	MUTEXptr rw;
+
+	rwid = (unsigned int) leer_registro(1);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	rw = rw_de_descriptor(rwid);
+	if (rw==NULL || PROPIETARIO_MUTEX(rw)==p_proc_actual->id)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, cerrojo con rwid: %d no encontrado o bloqueado en escritura por el proceso\n",rwid);
+		fijar_nivel_int(n_interrupcion);
+		return -1;
+	}
+
+	if (p_proc_actual->lecturas[rwid]==0 &&
+		(rw->palabra.estado!=0 || rw->lista_procesos_esperando.primero!=NULL))
+	{
+		/* conceder_rw cuenta al proceso como lector antes de despertarlo */
+		rw->estad.esperas++;
+		estad_mutex_total.esperas++;
+		rw->num_lectores_esperando++;
+		bloquear_proceso_actual(&(rw->lista_lectores));
+	}
+	else
+		rw->lectores++;
+	p_proc_actual->lecturas[rwid]++;
+
+	fijar_nivel_int(n_interrupcion);
+	return 0;
+}
+
+/* llamada al sistema para bloquear en escritura */
+int lock_escritura(unsigned int rwid){
+
+	int n_interrupcion;
+	MUTEXptr rw;
+
+	rwid = (unsigned int) leer_registro(1);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	rw = rw_de_descriptor(rwid);
+	if (rw==NULL || PROPIETARIO_MUTEX(rw)==p_proc_actual->id || p_proc_actual->lecturas[rwid]>0)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, cerrojo con rwid: %d no encontrado o ya bloqueado por el proceso\n",rwid);
+		fijar_nivel_int(n_interrupcion);
+		return -1;
+	}
+
+	if (rw->palabra.estado!=0 || rw->lectores>0)
+	{
+		/* conceder_rw lo hace propietario antes de despertarlo */
+		rw->estad.esperas++;
+		estad_mutex_total.esperas++;
+		rw->num_procesos_esperando++;
+		bloquear_proceso_actual(&(rw->lista_procesos_esperando));
+	}
+	else
+		rw->palabra.estado=p_proc_actual->id+1;
+
+	fijar_nivel_int(n_interrupcion);
+	return 0;
+}
+
+/* llamada al sistema para desbloquear un cerrojo bloqueado en cualquier modo */
+int unlock_rw(unsigned int rwid){
+
+	int n_interrupcion, res;
+	MUTEXptr rw;
+
+	rwid = (unsigned int) leer_registro(1);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	res = -1;
+	if ((rw=rw_de_descriptor(rwid))!=NULL)
+		res = soltar_rw(rw, rwid);
+	if (res<0)
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, cerrojo con rwid: %d no encontrado o no bloqueado por el proceso\n",rwid);
+
+	fijar_nivel_int(n_interrupcion);
+	return res;
+}
+
+/* llamada al sistema para cerrar un cerrojo de lectura/escritura */
+int cerrar_rw(unsigned int rwid){
+
+	int n_interrupcion, res;
+
+	rwid = (unsigned int) leer_registro(1);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	res = -1;
+	if (rw_de_descriptor(rwid)!=NULL)
+		res = cerrar_descriptor(rwid);
+	if (res<0)
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, cerrojo con rwid: %d no encontrado\n",rwid);
+	fijar_nivel_int(n_interrupcion);
+
+	return res;
+}
+
+/* semaforos */
+
+/* llamada al sistema para crear un semaforo con su valor inicial. Comparte
+   con los mutex el espacio de nombres y los descriptores del proceso */
+int crear_sem(char *nombre, int valor){
+
+	char nom[MAX_NOM_MUT+1];
+	int n_interrupcion, desc;
+	MUTEXptr s;
+
+	nombre = (char*) leer_registro(1);
+	valor = (int) leer_registro(2);
+
+	if (valor<0)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, valor inicial de semaforo negativo\n");
+		return -1;
+	}
+	if (leer_nombre_mutex(nombre, nom)<0)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, nombre de semaforo sobrepasa la logintud establecida\n");
+		return -1;
+	}
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	desc = crear_objeto(nom, CLASE_SEM, &s);
+	if (desc>=0)
+		s->valor=valor;
+	fijar_nivel_int(n_interrupcion);
+	return desc;
+}
+
+/* llamada al sistema para abrir un semaforo */
+int abrir_sem(char *nombre){
+
+	char nom[MAX_NOM_MUT+1];
+	int n_interrupcion, desc;
+	MUTEXptr s;
+
+	nombre = (char*) leer_registro(1);
+
+	if (leer_nombre_mutex(nombre, nom)<0)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, nombre de semaforo sobrepasa la logintud establecida\n");
+		return -1;
+	}
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	desc = abrir_objeto(nom, CLASE_SEM, &s);
+	fijar_nivel_int(n_interrupcion);
+	return desc;
+}
+
+/* llamada al sistema que resta n unidades al semaforo esperando si no
+   las hay. Se atiende en orden de llegada: aunque haya unidades para
+   este proceso espera si otro lo hacia antes */
+int esperar_sem(unsigned int semid, int n){
+
+	int n_interrupcion;
+	MUTEXptr s;
+
+	semid = (unsigned int) leer_registro(1);
+	n = (int) leer_registro(2);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	s = sem_de_descriptor(semid);
+	if (s==NULL || n<=0)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, semaforo con semid: %d no encontrado o %d unidades no validas\n",semid,n);
+		fijar_nivel_int(n_interrupcion);
+		return -1;
+	}
+
+	if (s->lista_procesos_esperando.primero==NULL && s->valor>=n)
+		s->valor-=n;
+	else
+	{
+		/* senalar_sem resta las unidades antes de despertarlo */
+		s->estad.esperas++;
+		estad_mutex_total.esperas++;
+		p_proc_actual->unidades_pedidas=n;
+		s->num_procesos_esperando++;
+		bloquear_proceso_actual(&(s->lista_procesos_esperando));
+	}
+
+	fijar_nivel_int(n_interrupcion);
+	return 0;
+}
+
+/* llamada al sistema que suma n unidades al semaforo y despierta en una
+   sola entrada a todos los procesos que esperaban y ya pueden servirse */
+int senalar_sem(unsigned int semid, int n){
+
+	int n_interrupcion;
+	MUTEXptr s;
+	BCPptr p_proc_bloqueado;
+
+	semid = (unsigned int) leer_registro(1);
+	n = (int) leer_registro(2);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	s = sem_de_descriptor(semid);
+	if (s==NULL || n<=0)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, semaforo con semid: %d no encontrado o %d unidades no validas\n",semid,n);
+		fijar_nivel_int(n_interrupcion);
+		return -1;
+	}
+	/* el valor nunca es negativo, por lo que INT_MAX-n no desborda */
+	if (s->valor>INT_MAX-n)
+	{
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, senalar %d unidades desbordaria el semaforo %s\n",n,s->nombre);
+		fijar_nivel_int(n_interrupcion);
+		return -1;
+	}
+
+	s->valor+=n;
+	while ((p_proc_bloqueado=s->lista_procesos_esperando.primero)!=NULL &&
+		p_proc_bloqueado->unidades_pedidas<=s->valor)
+	{
+		s->valor-=p_proc_bloqueado->unidades_pedidas;
+		s->num_procesos_esperando--;
+		despertar_primero(&(s->lista_procesos_esperando));
+		traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Proceso id: %d DESPERTADO por semaforo %s\n",p_proc_bloqueado->id,s->nombre);
+	}
+
+	fijar_nivel_int(n_interrupcion);
+	return 0;
+}
+
+/* llamada al sistema para cerrar un semaforo */
+int cerrar_sem(unsigned int semid){
+
+	int n_interrupcion, res;
+
+	semid = (unsigned int) leer_registro(1);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	res = -1;
+	if (sem_de_descriptor(semid)!=NULL)
+		res = cerrar_descriptor(semid);
+	if (res<0)
+		traza(TRAZA_AVISO, TRAZA_MUTEX, "Error, semaforo con semid: %d no encontrado\n",semid);
+	fijar_nivel_int(n_interrupcion);
+
+	return res;
+}
+
+/* creacion de procesos por lotes */
+
+/* llamada al sistema que crea n procesos del mismo programa, cargando su imagen
+   una sola vez, y devuelve sus ids en el vector ids. Retorna el numero de
+   procesos creados (puede ser menor que n si se llena la tabla) o -1 */
+int crear_procesos(char *prog, unsigned int n, int *ids){
+
+	IMAGENptr imagen;
+	BCP *p_proc;
+	unsigned int i;
+
+	prog = (char *) leer_registro(1);
+	n = (unsigned int) leer_registro(2);
+	ids = (int *) leer_registro(3);
+
+	traza(TRAZA_INFO, TRAZA_PROC, "-> PROC %d: CREAR %u PROCESOS\n", p_proc_actual->id, n);
+	/* no caben mas que los de la tabla de procesos en su tamano maximo */
+	if (n==0 || n>MAX_PROC)
+	{
+		traza(TRAZA_AVISO, TRAZA_PROC, "Error, no se pueden crear %u procesos\n", n);
+		return -1;
+	}
+
+	imagen=obtener_imagen(prog);
+	if (imagen==NULL)
+		return -1;
+
+	for (i=0; i<n; i++)
+	{
+		/* cada proceso consume una referencia de la imagen */
+		if (i>0)
+			retener_imagen(imagen);
+		p_proc=crear_tarea_imagen(imagen, imagen->pc_inicial);
+		if (p_proc==NULL)
+		{
+			soltar_imagen(imagen);
+			break;
+		}
+		accediendo_parametro=1;
+		ids[i]=p_proc->id;
+		accediendo_parametro=0;
+	}
+
+	return (i>0) ? i : -1;
+}
+
+/* hilos */
+
+/* llamada al sistema que crea un hilo: un proceso que comparte la imagen del
+   actual y solo tiene pila y contexto propios. Arranca en la lanzadera de
+   la biblioteca, que obtiene funcion y argumento con datos_hilo */
+int crear_hilo(void *lanzadera, void *funcion, void *arg){
+
+	BCP *p_proc;
+
+	lanzadera = (void *) leer_registro(1);
+	funcion = (void *) leer_registro(2);
+	arg = (void *) leer_registro(3);
+
+	traza(TRAZA_INFO, TRAZA_PROC, "-> PROC %d: CREAR HILO\n", p_proc_actual->id);
+
+	/* el hilo mantiene una referencia de la imagen hasta que termina */
+	retener_imagen(p_proc_actual->imagen);
+	p_proc=crear_tarea_imagen(p_proc_actual->imagen, lanzadera);
+	if (p_proc==NULL)
 	{
-		contador_lista_bloqueados_mutex--;
-		BCPptr p_proc_bloqueado = lista_bloqueados_mutex.primero;
-		p_proc_bloqueado->estado = LISTO;
-		eliminar_primero(&lista_bloqueados_mutex);
-		insertar_ultimo(&lista_listos,p_proc_bloqueado);
-		printk("Proceso id %d DESBLOQUEADO\n",p_proc_bloqueado->id);
+		soltar_imagen(p_proc_actual->imagen);
+		return -1;
 	}
-	
+	p_proc->funcion_hilo=funcion;
+	p_proc->arg_hilo=arg;
+	return p_proc->id;
+}
 
-	fijar_nivel_int(n_interrupcion);
+/* llamada al sistema usada por la lanzadera de un hilo para obtener la
+   funcion que debe ejecutar y su argumento */
+int datos_hilo(void **funcion, void **arg){
+
+	funcion = (void **) leer_registro(1);
+	arg = (void **) leer_registro(2);
 
+	if (p_proc_actual->funcion_hilo==NULL)
+		return -1;	/* no es un hilo */
+	accediendo_parametro=1;
+	*funcion=p_proc_actual->funcion_hilo;
+	*arg=p_proc_actual->arg_hilo;
+	accediendo_parametro=0;
 	return 0;
 }
-/* rutinas auxiliares */
 
-int buscarPosicionMutexLibre(){
-	int i;
-	for (i = 0; i < NUM_MUT; i++)
+/* cache de imagenes */
+
+/* busca, entre los objetos cargados, el que contiene el codigo de la
+   imagen y anota la zona escribible que no queda protegida tras reubicar
+   (.data y .bss). Funcion auxiliar para dl_iterate_phdr */
+static int buscar_datos_imagen(struct dl_phdr_info *info, size_t tam, void *arg){
+	IMAGENptr img=arg;
+	unsigned long pc=(unsigned long)img->pc_inicial;
+	unsigned long ini=0, fin=0, fin_relro=0, dir;
+	int i, contiene=0;
+
+	for (i=0; i<info->dlpi_phnum; i++)
 	{
-		if (lista_mutex[i].estado==LIBRE)
+		const ElfW(Phdr) *ph=&info->dlpi_phdr[i];
+
+		dir=info->dlpi_addr+ph->p_vaddr;
+		if (ph->p_type==PT_LOAD && pc>=dir && pc<dir+ph->p_memsz)
+			contiene=1;
+		if (ph->p_type==PT_LOAD && (ph->p_flags&PF_W))
 		{
-			return i;	/* devuelve la posicion del mutex libre */
+			ini=dir;
+			fin=dir+ph->p_memsz;
 		}
-		
+		if (ph->p_type==PT_GNU_RELRO)
+			fin_relro=dir+ph->p_memsz;
 	}
-	return -1;
+	if (!contiene)
+		return 0;	/* sigue con el siguiente objeto */
+
+	if (fin_relro>ini)
+		ini=fin_relro;
+	if (fin>ini)
+	{
+		img->datos=(void *)ini;
+		img->tam_datos=fin-ini;
+	}
+	return 1;
 }
 
-int buscarMutexPorNombre(char *nombre){
-	int i;
-	for ( i = 0; i < NUM_MUT; i++)
+/* guarda una copia de los datos de una imagen recien cargada para poder
+   restaurarlos al reutilizarla. Si no se consigue la imagen no tendra copia
+   y se volvera a cargar */
+static void copiar_datos_imagen(IMAGENptr img){
+	img->datos=img->copia_datos=NULL;
+	img->tam_datos=0;
+	dl_iterate_phdr(buscar_datos_imagen, img);
+	if (img->tam_datos>0 && (img->copia_datos=malloc(img->tam_datos))!=NULL)
+		memcpy(img->copia_datos, img->datos, img->tam_datos);
+}
+
+static void descargar_imagen(IMAGENptr img);
+
+/* obtiene la imagen del programa, reutilizando la ya cargada si existe.
+   Una imagen que no usaba ningun proceso vuelve a su estado inicial */
+IMAGENptr obtener_imagen(char *prog){
+	IMAGENptr img;
+	void *mem, *pc_inicial;
+
+	for (img=lista_imagenes; img; img=img->siguiente)
+		if (strcmp(img->nombre,prog)==0)
+			break;
+
+	if (img && img->referencias==0)
 	{
-		if (strcmp(lista_mutex[i].nombre,nombre)==0)
+		/* sin copia de sus datos se descarga y se carga de nuevo */
+		num_imagenes_residentes--;
+		if (img->copia_datos)
+			memcpy(img->datos, img->copia_datos, img->tam_datos);
+		else
 		{
-			return i;	/* devuelve la posicion del mutex encontrado */
+			descargar_imagen(img);
+			img=NULL;
 		}
-		
 	}
-	return -1;			/* devuelve -1 si no encuentra mutex */
+	if (img)
+	{
+		aciertos_cache_imagenes++;
+		img->referencias++;
+		img->ultimo_uso=++marca_uso_imagenes;
+		return img;
+	}
+
+	fallos_cache_imagenes++;
+	mem=crear_imagen(prog, &pc_inicial);
+	if (mem==NULL)
+		return NULL;	/* no existe el programa */
+	img=malloc(sizeof(imagen));
+	if (img)
+		img->nombre=malloc(strlen(prog)+1);
+	if (img==NULL || img->nombre==NULL)
+	{
+		free(img);
+		liberar_imagen(mem);
+		return NULL;
+	}
+	strcpy(img->nombre,prog);
+	img->mem=mem;
+	img->pc_inicial=pc_inicial;
+	img->referencias=1;
+	img->ultimo_uso=++marca_uso_imagenes;
+	copiar_datos_imagen(img);
+	img->siguiente=lista_imagenes;
+	lista_imagenes=img;
+	return img;
+}
+
+/* anade una referencia a una imagen ya cargada */
+void retener_imagen(IMAGENptr img){
+	img->referencias++;
+	img->ultimo_uso=++marca_uso_imagenes;
+}
+
+/* descarga una imagen y la saca de la lista de imagenes cargadas */
+static void descargar_imagen(IMAGENptr img){
+	IMAGENptr *pp;
+	void *mem=img->mem;
+
+	for (pp=&lista_imagenes; *pp!=img; pp=&(*pp)->siguiente);
+	*pp=img->siguiente;
+	free(img->copia_datos);
+	free(img->nombre);
+	free(img);
+	liberar_imagen(mem);	/* si es la ultima el HAL apaga el sistema */
+}
+
+/* deja de usar una imagen; si queda sin usar se mantiene cargada y, si
+   se supera el limite de residentes, se descarga la usada hace mas tiempo */
+void soltar_imagen(IMAGENptr img){
+	IMAGENptr aux, lru;
+
+	if (--img->referencias>0)
+		return;
+	img->ultimo_uso=++marca_uso_imagenes;
+
+	/* sin procesos: se descargan todas para que el HAL apague el sistema */
+	if (num_procesos==0)
+	{
+		vaciar_cache_imagenes();
+		return;
+	}
+
+	if (++num_imagenes_residentes<=MAX_IMAGENES_RESIDENTES)
+		return;
+	lru=NULL;
+	for (aux=lista_imagenes; aux; aux=aux->siguiente)
+		if (aux->referencias==0 && (lru==NULL || aux->ultimo_uso<lru->ultimo_uso))
+			lru=aux;
+	num_imagenes_residentes--;
+	descargar_imagen(lru);
+}
+
+/* descarga todas las imagenes sin usar */
+void vaciar_cache_imagenes(){
+	IMAGENptr img, sig;
+
+	for (img=lista_imagenes; img; img=sig)
+	{
+		sig=img->siguiente;
+		if (img->referencias==0)
+			descargar_imagen(img);
+	}
+	num_imagenes_residentes=0;
+}
+
+/* reserva de pilas */
+
+/* obtiene una pila para un proceso nuevo, de la reserva si es posible */
+void * obtener_pila(){
+	if (num_pilas_pool>0)
+	{
+		aciertos_pool_pilas++;
+		return pool_pilas[--num_pilas_pool];
+	}
+	fallos_pool_pilas++;
+	return crear_pila(TAM_PILA);
+}
+
+/* devuelve la pila de un proceso terminado a la reserva o la libera si esta llena */
+void devolver_pila(void *pila){
+	if (num_pilas_pool<POOL_PILAS_MAX)
+		pool_pilas[num_pilas_pool++]=pila;
+	else
+		liberar_pila(pila);
+}
+
+/* repone la reserva hasta la marca baja */
+void rellenar_pool_pilas(){
+	while (num_pilas_pool<POOL_PILAS_MIN)
+		pool_pilas[num_pilas_pool++]=crear_pila(TAM_PILA);
+}
+
+/* estadisticas */
+
+/* vuelca las estadisticas del sistema, se invoca al terminar el ultimo proceso */
+void mostrar_estadisticas(){
+	vaciar_trazas();
+	printk("-> ESTADISTICAS: reserva de pilas: %lu aciertos, %lu fallos, %d libres\n",
+		aciertos_pool_pilas, fallos_pool_pilas, num_pilas_pool);
+	printk("-> ESTADISTICAS: cache de imagenes: %lu aciertos, %lu fallos, %d residentes\n",
+		aciertos_cache_imagenes, fallos_cache_imagenes, num_imagenes_residentes);
+	printk("-> ESTADISTICAS: mutex: %lu esperas, %lu traspasos, %lu fallos de readquisicion, %lu interbloqueos\n",
+		estad_mutex_total.esperas, estad_mutex_total.traspasos, estad_mutex_total.fallos_readquisicion,
+		estad_mutex_total.interbloqueos);
+	mostrar_estad_llamadas();
+}
+
+/* trazas del kernel */
+
+/* guarda un mensaje en el anillo de trazas, sobrescribiendo el mas antiguo
+   si esta lleno. Se usa a traves de la macro traza */
+void registrar_traza(const char *formato, ...){
+	va_list args;
+	int nivel;
+
+	nivel=fijar_nivel_int(NIVEL_3);
+	if (trazas_cola-trazas_cab==NUM_TRAZAS)
+	{
+		trazas_cab++;
+		trazas_perdidas++;
+	}
+	va_start(args, formato);
+	vsnprintf(trazas[trazas_cola%NUM_TRAZAS], TAM_TRAZA, formato, args);
+	va_end(args);
+	trazas_cola++;
+	fijar_nivel_int(nivel);
+}
+
+/* escribe en la consola los mensajes pendientes del anillo de trazas */
+void vaciar_trazas(){
+	int nivel;
+
+	nivel=fijar_nivel_int(NIVEL_3);
+	if (trazas_perdidas>0)
+	{
+		printk("-> TRAZAS: %lu mensajes perdidos\n", trazas_perdidas);
+		trazas_perdidas=0;
+	}
+	while (trazas_cab!=trazas_cola)
+		printk("%s", trazas[trazas_cab++%NUM_TRAZAS]);
+	fijar_nivel_int(nivel);
+}
+
+/* vuelca las trazas pendientes antes de detener el sistema */
+void panico_kernel(char *mens){
+	vaciar_trazas();
+	panico(mens);
+}
+
+/* estadisticas de llamadas */
+
+/* cubeta del histograma de latencia que corresponde a una duracion en ticks */
+static int cubeta_latencia(unsigned long ticks){
+	int cubeta=0;
+
+	while (ticks>0 && cubeta<NUM_CUBETAS_LATENCIA-1)
+	{
+		ticks>>=1;
+		cubeta++;
+	}
+	return cubeta;
+}
+
+/* ejecuta el servicio nserv (ya validado) anotando sus estadisticas en los
+   contadores globales y en los del proceso que lo invoca */
+int ejecutar_servicio(int nserv){
+	BCP *proc=p_proc_actual;
+	unsigned long inicio=ticks_totales;
+	int res, cubeta;
+
+	/* la llamada se cuenta antes porque terminar_proceso no vuelve */
+	estad_llamadas[nserv].llamadas++;
+	proc->estad_llamadas[nserv].llamadas++;
+
+	res=(tabla_servicios[nserv].fservicio)();
+
+	/* si se ha bloqueado la latencia incluye el tiempo de espera */
+	cubeta=cubeta_latencia(ticks_totales-inicio);
+	estad_llamadas[nserv].latencia[cubeta]++;
+	proc->estad_llamadas[nserv].latencia[cubeta]++;
+	if (res<0)
+	{
+		estad_llamadas[nserv].errores++;
+		proc->estad_llamadas[nserv].errores++;
+	}
+	return res;
+}
+
+/* vuelca los contadores globales de las llamadas usadas */
+void mostrar_estad_llamadas(){
+	int i, j;
+
+	for (i=0; i<NSERVICIOS; i++)
+	{
+		if (estad_llamadas[i].llamadas==0)
+			continue;
+		printk("-> ESTADISTICAS: llamada %d: %lu veces, %lu errores, latencia:",
+			i, estad_llamadas[i].llamadas, estad_llamadas[i].errores);
+		for (j=0; j<NUM_CUBETAS_LATENCIA; j++)
+			printk(" %lu", estad_llamadas[i].latencia[j]);
+		printk("\n");
+	}
+}
+
+/* llamada al sistema que copia en *estad los contadores del servicio indicado,
+   los globales o, si solo_proceso no es 0, los del proceso actual */
+int obtener_estad_llamadas(int servicio, struct estad_llamada *estad, int solo_proceso){
+
+	servicio = (int) leer_registro(1);
+	estad = (struct estad_llamada *) leer_registro(2);
+	solo_proceso = (int) leer_registro(3);
+
+	if (servicio<0 || servicio>=NSERVICIOS)
+		return -1;
+
+	/* si la direccion no es valida exc_mem aborta el proceso */
+	accediendo_parametro=1;
+	*estad = solo_proceso ? p_proc_actual->estad_llamadas[servicio] : estad_llamadas[servicio];
+	accediendo_parametro=0;
+	return 0;
+}
+
+/* anillo de llamadas */
+
+/* llamada al sistema que registra el anillo de llamadas del proceso (NULL lo anula) */
+int registrar_anillo(struct anillo_llamadas *anillo){
+
+	anillo = (struct anillo_llamadas *) leer_registro(1);
+	p_proc_actual->anillo = anillo;
+	return 0;
+}
+
+/* llamada al sistema que trata todas las peticiones pendientes del anillo del
+   proceso, dejando un resultado por cada una. Los parametros de cada peticion se
+   pasan al servicio en los registros 1 a 3, como en una llamada normal.
+   Devuelve el numero de peticiones tratadas */
+int entrar_anillo(){
+
+	struct anillo_llamadas *anillo = p_proc_actual->anillo;
+	struct peticion_llamada pet;
+	int i, res, tratadas = 0;
+
+	if (anillo==NULL)
+		return -1;
+
+	for (;;)
+	{
+		/* la memoria del anillo es del proceso: si no es valida se aborta */
+		accediendo_parametro=1;
+		if ((anillo->cab_pet==anillo->cola_pet) ||
+			(anillo->cola_res-anillo->cab_res==TAM_ANILLO))
+		{
+			accediendo_parametro=0;
+			break;	/* sin peticiones o sin hueco para el resultado */
+		}
+		pet=anillo->peticiones[anillo->cab_pet%TAM_ANILLO];
+		anillo->cab_pet++;
+		accediendo_parametro=0;
+
+		/* no se admiten llamadas que manipulan el propio anillo */
+		if (pet.servicio<0 || pet.servicio>=NSERVICIOS ||
+			pet.servicio==REGISTRAR_ANILLO || pet.servicio==ENTRAR_ANILLO)
+			res=-1;
+		else
+		{
+			for (i=0; i<3; i++)
+				escribir_registro(i+1, pet.args[i]);
+			res=ejecutar_servicio(pet.servicio);
+		}
+
+		accediendo_parametro=1;
+		anillo->resultados[anillo->cola_res%TAM_ANILLO].dato=pet.dato;
+		anillo->resultados[anillo->cola_res%TAM_ANILLO].resultado=res;
+		anillo->cola_res++;
+		accediendo_parametro=0;
+		tratadas++;
+	}
+	return tratadas;
+}
+
+/* contabilidad */
+
+/* llamada al sistema que devuelve los ticks transcurridos desde el arranque y,
+   si tiempos no es nulo, los ticks del proceso en modo usuario y sistema */
+int tiempos_proceso(struct tiempos_ejec *tiempos){
+
+	int n_interrupcion, real;
+	struct tiempos_ejec t;
+
+	tiempos = (struct tiempos_ejec *) leer_registro(1);
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	real = ticks_totales;
+	t.usuario = p_proc_actual->ticks_usuario;
+	t.sistema = p_proc_actual->ticks_sistema;
+	fijar_nivel_int(n_interrupcion);
+
+	if (tiempos)
+	{
+		/* si la direccion no es valida exc_mem aborta el proceso */
+		accediendo_parametro=1;
+		*tiempos=t;
+		accediendo_parametro=0;
+	}
+	return real;
+}
+
+/* pagina de informacion */
+
+/* llamada al sistema que deja en *pagina la direccion de la pagina de
+   informacion del kernel, que el proceso solo debe leer */
+int obtener_info_kernel(struct info_kernel **pagina){
+
+	pagina = (struct info_kernel **) leer_registro(1);
+
+	/* si la direccion no es valida exc_mem aborta el proceso */
+	accediendo_parametro=1;
+	*pagina=&pagina_info;
+	accediendo_parametro=0;
+	return 0;
+}
+
+/* llamada al sistema usada por la biblioteca para saber si sigue vivo el
+   proceso con un numero de serie y recuperar los datos de los que no
+   terminaron con terminar_proceso (p.ej. abortados por una excepcion) */
+int serie_viva(unsigned long serie){
+
+	serie = (unsigned long) leer_registro(1);
+
+	return serie!=0 && buscar_BCP_por_serie(serie)!=NULL;
+}
+
+/* prioridades */
+
+/* llamada al sistema que fija la prioridad base del proceso actual,
+   devuelve la previa. La efectiva puede ser mayor si hereda de un mutex */
+int fijar_prioridad(unsigned int prioridad){
+
+	int n_interrupcion, previa;
+
+	prioridad = (unsigned int) leer_registro(1);
+	if (prioridad>=NUM_PRIORIDADES)
+	{
+		traza(TRAZA_AVISO, TRAZA_LLAMSIS, "Error, prioridad %d fuera de rango\n",prioridad);
+		return -1;
+	}
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	previa = p_proc_actual->prioridad_base;
+	p_proc_actual->prioridad_base = prioridad;
+	cambiar_prioridad(p_proc_actual, prioridad_heredada(p_proc_actual));
+
+	fijar_nivel_int(n_interrupcion);
+	return previa;
+}
+/* rutinas auxiliares */
+
+/*
+ * Funciones relacionadas con la tabla de mutex:
+ *	iniciar_tabla_mutex crecer_tabla_mutex buscar_mutex_libre
+ *	liberar_mutex buscar_mutex_por_nombre insertar_mutex_por_nombre
+ *
+ * Como la de procesos, la tabla crece por bloques de TAM_BLOQUE_MUTEX
+ * mutex que nunca se liberan, por lo que los punteros son estables. Los
+ * libres forman una lista enlazada por sig_libre y los que estan en uso
+ * una tabla hash indexada por nombre.
+ */
+
+void iniciar_tabla_mutex(){
+	int i;
+
+	num_bloques_mutex=0;
+	mutex_libres=NULL;
+	contador_lista_mutex=0;
+	for (i=0; i<TAM_HASH_MUTEX; i++)
+		hash_mutex[i]=NULL;
+}
+
+/* añade un bloque de mutex libres a la tabla */
+static int crecer_tabla_mutex(){
+	MUTEXptr bloque;
+	int i;
+
+	if (num_bloques_mutex==MAX_BLOQUES_MUTEX)
+		return -1;	/* tabla en su tamano maximo */
+	bloque=malloc(TAM_BLOQUE_MUTEX*sizeof(mutex));
+	if (bloque==NULL)
+		return -1;
+
+	bloques_mutex[num_bloques_mutex++]=bloque;
+	for (i=0; i<TAM_BLOQUE_MUTEX; i++) {
+		bloque[i].estado=LIBRE;
+		bloque[i].palabra.estado=0;
+		bloque[i].palabra.contador=0;
+		bloque[i].num_procesos_esperando=0;
+		bloque[i].lista_procesos_esperando.primero=NULL;
+		bloque[i].lista_procesos_esperando.ultimo=NULL;
+		bloque[i].lectores=0;
+		bloque[i].num_lectores_esperando=0;
+		bloque[i].lista_lectores.primero=NULL;
+		bloque[i].lista_lectores.ultimo=NULL;
+		bloque[i].num_abiertos=0;
+		bloque[i].sig_hash=NULL;
+		bloque[i].sig_libre=mutex_libres;
+		mutex_libres=&bloque[i];
+	}
+	return 0;
+}
+
+/* obtiene un mutex libre, haciendo crecer la tabla si no queda ninguno */
+MUTEXptr buscar_mutex_libre(){
+	MUTEXptr m;
+
+	if ((mutex_libres==NULL) && (crecer_tabla_mutex()<0))
+		return NULL;
+	m=mutex_libres;
+	mutex_libres=m->sig_libre;
+	contador_lista_mutex++;
+	return m;
+}
+
+static unsigned int hash_nombre(char *nombre){
+	unsigned int h=5381;
+
+	while (*nombre)
+		h=h*33+(unsigned char)*nombre++;
+	return h%TAM_HASH_MUTEX;
+}
+
+MUTEXptr buscar_mutex_por_nombre(char *nombre){
+	MUTEXptr m;
+
+	for (m=hash_mutex[hash_nombre(nombre)]; m; m=m->sig_hash)
+		if (strcmp(m->nombre,nombre)==0)
+			return m;	/* devuelve el mutex encontrado */
+	return NULL;		/* devuelve NULL si no encuentra mutex */
+}
+
+void insertar_mutex_por_nombre(MUTEXptr m){
+	unsigned int h=hash_nombre(m->nombre);
+
+	m->sig_hash=hash_mutex[h];
+	hash_mutex[h]=m;
+}
+
+/* devuelve a la lista de libres un mutex que ya nadie tiene abierto y
+   despierta a un proceso que esperase por falta de mutex */
+void liberar_mutex(MUTEXptr m){
+	MUTEXptr *pm=&hash_mutex[hash_nombre(m->nombre)];
+	BCPptr p_proc_bloqueado;
+
+	for ( ; *pm!=m; pm=&(*pm)->sig_hash);
+	*pm=m->sig_hash;
+
+	m->estado=LIBRE;
+	m->sig_libre=mutex_libres;
+	mutex_libres=m;
+	contador_lista_mutex--;
+
+	if ((p_proc_bloqueado=lista_bloqueados_mutex.primero)!=NULL)
+	{
+		eliminar_primero(&lista_bloqueados_mutex);
+		p_proc_bloqueado->estado=LISTO;
+		insertar_listo(p_proc_bloqueado);
+		traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Proceso id %d DESBLOQUEADO\n",p_proc_bloqueado->id);
+	}
+}
+
+/* copia el nombre del usuario, devuelve -1 si sobrepasa MAX_NOM_MUT */
+int leer_nombre_mutex(char *nombre, char *destino){
+	int i;
+
+	/* si la direccion no es valida exc_mem aborta el proceso */
+	accediendo_parametro=1;
+	for (i=0; i<=MAX_NOM_MUT && nombre[i]!='\0'; i++)
+		destino[i]=nombre[i];
+	accediendo_parametro=0;
+
+	if (i>MAX_NOM_MUT)
+		return -1;
+	destino[i]='\0';
+	return 0;
 }
 
 int buscarDescriptorLibrePorceso(){
 	int i;
 	for ( i = 0; i < NUM_MUT_PROC; i++)
 	{
-		if (p_proc_actual->descriptores[i]==-1)
+		if (p_proc_actual->descriptores[i]==NULL)
 		{
 			return i;	/* devuelve la posicion del descriptor libre */
 		}
@@ -756,33 +2391,190 @@ int buscarDescriptorLibrePorceso(){
 	return -1;
 }
 
-int *buscarMutexPorID(int mutexid){
-	int i;
-	static int retorno[2] = {-1,-1};
-	for ( i = 0; i < NUM_MUT_PROC; i++)
+/* devuelve el objeto de la clase indicada asociado a un descriptor del
+   proceso actual (NULL si no es valido o es de otra clase) */
+MUTEXptr objeto_de_descriptor(unsigned int desc, int clase){
+	MUTEXptr m;
+
+	if (desc>=NUM_MUT_PROC)
+		return NULL;
+	m=p_proc_actual->descriptores[desc];
+	if (m==NULL || m->clase!=clase)
+		return NULL;
+	return m;
+}
+
+/* deja en *palabra (si no es NULL) la direccion de la palabra del mutex */
+void dar_palabra_mutex(struct palabra_mutex **palabra, MUTEXptr m){
+	if (palabra)
+	{
+		/* si la direccion no es valida exc_mem aborta el proceso */
+		accediendo_parametro=1;
+		*palabra=&m->palabra;
+		accediendo_parametro=0;
+	}
+}
+
+/* bloquea al proceso actual en la lista indicada y cambia de contexto */
+void bloquear_proceso_actual(lista_BCPs *lista){
+	BCPptr p_proc_bloqueado = p_proc_actual;
+
+	p_proc_bloqueado->estado = BLOQUEADO;
+	eliminar_listo(p_proc_bloqueado);
+	insertar_ultimo(lista,p_proc_bloqueado);
+	/* si espera un mutex su propietario hereda la prioridad si es mayor que la suya */
+	if (p_proc_bloqueado->mutex_esperado)
+		propagar_prioridad(propietario_mutex(p_proc_bloqueado->mutex_esperado));
+	p_proc_actual = planificador();
+	traza(TRAZA_DEPURACION, TRAZA_PLANIF, "C.CONTEXTO POR BLOQUEO de %d a %d\n",p_proc_bloqueado->id,p_proc_actual->id);
+	cambio_contexto(&(p_proc_bloqueado->contexto_regs),&(p_proc_actual->contexto_regs));
+}
+
+/* deja el mutex desbloqueado y despierta al primer proceso que lo espera,
+   que volvera a intentar bloquearlo. Si quedan otros en la lista el bit
+   de espera sigue activo: el despertado puede rendirse o ser adelantado y
+   el proximo lock o unlock debe entrar al kernel igualmente */
+void liberar_lock(MUTEXptr m){
+	BCPptr p_proc_bloqueado;
+
+	m->palabra.contador=0;
+	traza(TRAZA_DEPURACION, TRAZA_MUTEX, "Mutex %s DESBLOQUEADO\n",m->nombre);
+
+	p_proc_bloqueado=despertar_esperando(m);
+	m->palabra.estado=m->lista_procesos_esperando.primero ? MUTEX_ESPERANDO : 0;
+	if (p_proc_bloqueado!=NULL)
 	{
-		if (p_proc_actual->descriptores[i]==mutexid)
+		/* con TRASPASO el despertado sale de lock ya como propietario y
+		   nadie puede adelantarle */
+		if (m->palabra.tipo&TRASPASO)
 		{
-			retorno[0]=i;
-			retorno[1]=p_proc_actual->descriptores[i];
-			return retorno;
+			m->palabra.estado=(p_proc_bloqueado->id+1) |
+				(m->lista_procesos_esperando.primero ? MUTEX_ESPERANDO : 0);
+			m->palabra.contador=1;
+			m->estad.traspasos++;
+			estad_mutex_total.traspasos++;
+			/* el nuevo propietario hereda de los que siguen esperando */
+			propagar_prioridad(p_proc_bloqueado);
 		}
-		
 	}
-	return retorno;
+
+	/* quien lo suelta (siempre el proceso actual) deja de heredar de sus esperas */
+	propagar_prioridad(p_proc_actual);
 }
 
-void iniciar_lista_mutex(){
-	int i;
-	for ( i = 0; i < NUM_MUT; i++)
+/* comprueba si el proceso actual, al esperar a m, cerraria un ciclo en
+   el grafo de esperas: se sigue la cadena propietario -> mutex que espera
+   -> propietario... y hay ciclo si se vuelve al proceso actual */
+int hay_interbloqueo(MUTEXptr m){
+	int n;
+	BCPptr p;
+
+	for (n=0, p=propietario_mutex(m); p!=NULL && n<MAX_CADENA_HERENCIA; n++)
+	{
+		if (p==p_proc_actual)
+		{
+			traza(TRAZA_AVISO, TRAZA_MUTEX, "Interbloqueo: proceso id: %d esperando mutex %s cierra un ciclo de %d procesos\n",
+				p_proc_actual->id,m->nombre,n+1);
+			return 1;
+		}
+		p=p->mutex_esperado ? propietario_mutex(p->mutex_esperado) : NULL;
+	}
+	return 0;
+}
+
+/* proceso propietario de un mutex (NULL si esta libre) */
+BCPptr propietario_mutex(MUTEXptr m){
+	if (MUTEX_LIBRE(m))
+		return NULL;
+	return buscar_BCP_por_id(PROPIETARIO_MUTEX(m));
+}
+
+/* prioridad que corresponde a un proceso: su base o la del proceso mas
+   prioritario que espere a alguno de los mutex que tiene bloqueados */
+int prioridad_heredada(BCPptr p){
+	int i, prioridad=p->prioridad_base;
+	MUTEXptr m;
+	BCPptr paux;
+
+	/* solo puede tener bloqueados mutex que tiene abiertos */
+	for (i=0; i<NUM_MUT_PROC; i++)
+	{
+		m=p->descriptores[i];
+		if (m==NULL || m->clase!=CLASE_MUTEX || m->palabra.estado==0 ||
+			PROPIETARIO_MUTEX(m)!=p->id)
+			continue;
+		for (paux=m->lista_procesos_esperando.primero; paux; paux=paux->siguiente)
+			if (paux->prioridad<prioridad)
+				prioridad=paux->prioridad;
+	}
+	return prioridad;
+}
+
+/* recalcula la prioridad de p y, si cambia y esta esperando a un mutex,
+   la de su propietario, siguiendo la cadena de mutex */
+void propagar_prioridad(BCPptr p){
+	int n, prioridad;
+
+	for (n=0; p!=NULL && n<MAX_CADENA_HERENCIA; n++)
+	{
+		prioridad=prioridad_heredada(p);
+		if (prioridad==p->prioridad)
+			return;
+		traza(TRAZA_DEPURACION, TRAZA_PLANIF, "Proceso id: %d pasa de prioridad %d a %d\n",p->id,p->prioridad,prioridad);
+		cambiar_prioridad(p, prioridad);
+		p=p->mutex_esperado ? propietario_mutex(p->mutex_esperado) : NULL;
+	}
+}
+
+/* cambia la prioridad efectiva de un proceso, moviendolo de nivel si esta listo */
+void cambiar_prioridad(BCPptr p, int prioridad){
+	if (p->estado==LISTO)
+	{
+		eliminar_listo(p);
+		p->prioridad=prioridad;
+		insertar_listo(p);
+	}
+	else
+		p->prioridad=prioridad;
+
+	/* si el actual ha dejado de ser el mas prioritario se fuerza la replanificacion */
+	if (p==p_proc_actual && ffs(mapa_listos)-1<prioridad)
+		activar_int_SW();
+}
+
+/* cierra un descriptor del proceso actual: si lo tenia bloqueado lo libera
+   y si era el ultimo que lo tenia abierto el mutex desaparece */
+int cerrar_descriptor(unsigned int desc){
+	MUTEXptr m;
+
+	if (desc>=NUM_MUT_PROC || (m=p_proc_actual->descriptores[desc])==NULL)
+		return -1;
+
+	if (m->clase==CLASE_RW)
 	{
-		lista_mutex[i].contador_bloqueos=0;
-		lista_mutex[i].estado=LIBRE;
-		lista_mutex[i].id_proceso_propietario=-1;
-		lista_mutex[i].lista_procesos_esperando.primero=NULL;
-		lista_mutex[i].mutex_lock=UNLOCKED;
-		lista_mutex[i].num_procesos_esperando=0;
+		while (soltar_rw(m, desc)==0);
 	}
+	else if (m->palabra.estado!=0 && PROPIETARIO_MUTEX(m)==p_proc_actual->id)
+		liberar_lock(m);
+
+	p_proc_actual->descriptores[desc]=NULL;
+	p_proc_actual->num_descriptores_abiertos--;
+	traza(TRAZA_INFO, TRAZA_MUTEX, "%s %s CERRADO\n",nombre_clase[m->clase],m->nombre);
+
+	if (--m->num_abiertos==0)
+		liberar_mutex(m);
+	return 0;
+}
+
+/* cierre implicito de los mutex del proceso actual al terminar */
+void cerrar_mutex_proceso(){
+	int i, n_interrupcion;
+
+	n_interrupcion = fijar_nivel_int(NIVEL_3);
+	for (i=0; i<NUM_MUT_PROC && p_proc_actual->num_descriptores_abiertos>0; i++)
+		if (p_proc_actual->descriptores[i]!=NULL)
+			cerrar_descriptor(i);
+	fijar_nivel_int(n_interrupcion);
 }
 
 /* round-robin */
@@ -795,30 +2587,36 @@ void actualizarTick(){
 		{
 			/* decrementar contador de ticks */
 			p_proc_actual->contadorTicks--;
-			printk("Porceso id: %d, contador de ticks restantes: %d\n",p_proc_actual->id,p_proc_actual->contadorTicks);
+			pagina_info.ticks_rodaja=p_proc_actual->contadorTicks;
+			traza(TRAZA_DEPURACION, TRAZA_PLANIF, "Porceso id: %d, contador de ticks restantes: %d\n",p_proc_actual->id,p_proc_actual->contadorTicks);
 		}
 		if (p_proc_actual->contadorTicks==0)
 		{
-			printk("Proceso id: %d, activando interrupcion SW\n",p_proc_actual->id);
+			traza(TRAZA_DEPURACION, TRAZA_PLANIF, "Proceso id: %d, activando interrupcion SW\n",p_proc_actual->id);
 			activar_int_SW();
 		}
 	}
 }
-/* rutina para tratar interrupcion SW en round-robin */
+/* rutina para tratar interrupcion SW en round-robin y por prioridades */
 void tratarIntSW(){
-	if (lista_listos.primero==lista_listos.ultimo)
-	{
-		p_proc_actual->contadorTicks=TICKS_POR_RODAJA;
-		printk("Proceso id: %d, contador de ticks actualizado\n",p_proc_actual->id);
-	} else {
-		BCPptr p_proc_expulsado = p_proc_actual;
-		int n_interrupcion = fijar_nivel_int(NIVEL_1);
-		eliminar_elem(&lista_listos,p_proc_expulsado);
-		insertar_ultimo(&lista_listos,p_proc_expulsado);
-		fijar_nivel_int(n_interrupcion);
-		p_proc_actual = planificador();
-		p_proc_actual->contadorTicks=TICKS_POR_RODAJA;
-		printk("C.CONTEXTO POR EXPULSION de %d a %d\n",p_proc_expulsado->id,p_proc_actual->id);
+	BCPptr p_proc_expulsado = p_proc_actual;
+	int n_interrupcion = fijar_nivel_int(NIVEL_3);
+
+	/* si ha agotado la rodaja pasa al final de la cola de su nivel */
+	if (p_proc_expulsado->estado==LISTO && p_proc_expulsado->contadorTicks==0)
+	{
+		eliminar_listo(p_proc_expulsado);
+		insertar_listo(p_proc_expulsado);
+		p_proc_expulsado->contadorTicks=TICKS_POR_RODAJA;
+		traza(TRAZA_DEPURACION, TRAZA_PLANIF, "Proceso id: %d, contador de ticks actualizado\n",p_proc_expulsado->id);
+	}
+
+	/* puede haber otro del mismo nivel o uno mas prioritario */
+	p_proc_actual = planificador();
+	fijar_nivel_int(n_interrupcion);
+	if (p_proc_actual!=p_proc_expulsado)
+	{
+		traza(TRAZA_DEPURACION, TRAZA_PLANIF, "C.CONTEXTO POR EXPULSION de %d a %d\n",p_proc_expulsado->id,p_proc_actual->id);
 		cambio_contexto(&(p_proc_expulsado->contexto_regs),&(p_proc_actual->contexto_regs));
 	}
 }
@@ -844,17 +2642,18 @@ int main(){
 	iniciar_cont_teclado();		/* inici cont. teclado */
 
 	iniciar_tabla_proc();		/* inicia BCPs de tabla de procesos */
+	rellenar_pool_pilas();		/* reserva inicial de pilas */
 
 	/* --------cosas añadidas-------- */
-	iniciar_lista_mutex();		/* inicia lista_mutex del sistema */
+	iniciar_tabla_mutex();		/* inicia la tabla de mutex del sistema */
 
 	/* crea proceso inicial */
 	if (crear_tarea((void *)"init")<0)
-		panico("no encontrado el proceso inicial");
+		panico_kernel("no encontrado el proceso inicial");
 	
 	/* activa proceso inicial */
 	p_proc_actual=planificador();
 	cambio_contexto(NULL, &(p_proc_actual->contexto_regs));
-	panico("S.O. reactivado inesperadamente");
+	panico_kernel("S.O. reactivado inesperadamente");
 	return 0;
 }
@@ -42,10 +42,9 @@ int main(){
 	/* libera un descriptor de mutex (m1) */
 	cerrar_mutex(desc);
 	
-	/* Agotado num mutex del sistema. Debe bloquearse */
+	/* La tabla de mutex crece segun se necesita: no se bloquea */
 	if (crear_mutex("m17", 0)<0)
 		printf("error creando m17. NO DEBE SALIR\n");
-	/* se desbloquear� cuando se elimine m1 */
 
 	/* intenta crear el mismo mutex: devuelve un error porque ya existe */
 	if (crear_mutex("m17", 0)<0)
@@ -0,0 +1,31 @@
+/*
+ *  usuario/include/pruebas.h
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ *
+ * Fichero de cabecera con el apoyo comun de los programas de prueba.
+ *
+ * Muchas pruebas crean procesos de su propio programa. Todos ellos
+ * comparten las variables globales del programa (y de la biblioteca), por
+ * lo que el primero se reconoce por una marca global que activa antes de
+ * crear a los demas, y todos se coordinan mediante variables globales.
+ *
+ */
+
+#ifndef PRUEBAS_H
+#define PRUEBAS_H
+
+#include "servicios.h"
+
+/* consume CPU sin entrar al kernel durante los ticks indicados */
+static inline void consumir(unsigned long ticks){
+	unsigned long t=obtener_ticks();
+
+	while (obtener_ticks()-t<ticks);
+}
+
+#endif /* PRUEBAS_H */
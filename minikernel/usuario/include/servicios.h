@@ -22,6 +22,158 @@
 /* -----------cosas añadidas para mutex----------- */
 #define NO_RECURSIVO 0	/* tipo de mutex no recursivo */
 #define RECURSIVO 1		/* tipo de mutex recursivo */
+#define TRASPASO 2		/* se combina con el tipo: unlock cede el mutex al primero que
+						   espera en vez de dejarlo libre (equidad frente a rendimiento) */
+#define ERROR_PLAZO -2	/* lock_temporizado: vencio el plazo sin conseguir el mutex */
+#define ERROR_INTERBLOQUEO -3	/* lock: esperar cerraria un ciclo de esperas entre procesos */
+#define NUM_MUT_PROC 4 	/* numero maximo de mutex que puede tener abiertos un proceso */
+
+/* palabra de un mutex, compartida entre el kernel y los procesos que lo
+   tienen abierto: sin contienda lock y unlock la modifican atomicamente
+   sin llamada al sistema. estado vale 0 si esta libre o el id+1 del
+   propietario, con MUTEX_ESPERANDO activo mientras haya procesos en su
+   lista de espera, incluso libre tras un unlock que despierta a uno: asi
+   lock y unlock nunca lo cambian sin llamada si queda alguien esperando */
+#define MUTEX_ESPERANDO 0x40000000
+#define MUTEX_PROPIETARIO 0x3fffffff
+
+struct palabra_mutex {
+	int estado;			/* propietario y bit de espera */
+	int contador;		/* bloqueos del propietario (solo lo modifica el) */
+	int tipo;			/* NO_RECURSIVO|RECURSIVO, con TRASPASO si procede */
+};
+
+/* estadisticas de un mutex (llamada estad_mutex) */
+struct estad_mutex {
+	unsigned long esperas;		/* veces que un lock ha tenido que esperar */
+	unsigned long traspasos;	/* unlocks que han cedido el mutex a un proceso en espera */
+	unsigned long fallos_readquisicion;	/* despertados que lo encontraron ocupado de nuevo */
+	unsigned long interbloqueos;	/* esperas que habrian cerrado un ciclo */
+};
+
+/* -----------cosas añadidas para prioridades----------- */
+#define NUM_PRIORIDADES 32		/* numero de niveles de prioridad (0 es la maxima) */
+#define PRIORIDAD_DEFECTO 16	/* prioridad con la que se crea un proceso */
+
+/* -----------cosas añadidas para contabilidad----------- */
+/* definicion del tipo usado por la llamada tiempos_proceso */
+struct tiempos_ejec {
+	int usuario;		/* ticks en modo usuario */
+	int sistema;		/* ticks en modo sistema */
+};
+
+/* -----------cosas añadidas para la pagina de informacion----------- */
+/* pagina de solo lectura para los procesos que el kernel mantiene al dia,
+   de modo que pueden leer estos datos sin hacer una llamada al sistema */
+struct info_kernel {
+	int id_proceso;			/* id del proceso en ejecucion */
+	unsigned long ticks;	/* ticks de reloj desde el arranque */
+	int ticks_rodaja;		/* ticks que le quedan de rodaja al proceso en ejecucion */
+	int num_listos;			/* procesos listos (incluido el que esta en ejecucion) */
+	unsigned long serie_proceso;	/* numero de serie (nunca reutilizado) del proceso en ejecucion */
+};
+
+/* -----------cosas añadidas para la salida con buffer----------- */
+/* modos de la salida de escribir (y por tanto de printf) de cada proceso */
+#define SALIDA_SIN_BUFFER 0		/* cada escritura es una llamada al sistema */
+#define SALIDA_POR_LINEAS 1		/* se vuelca al escribir un fin de linea (por defecto) */
+#define SALIDA_COMPLETA 2		/* se vuelca solo cuando se llena el buffer */
+/* procesos vivos de un mismo programa que pueden tener buffer de salida y
+   mutex sin llamada al sistema: los demas escriben sin buffer y hacen
+   siempre las llamadas de mutex */
+#define NUM_DATOS_PROCESOS 8
+
+/* -----------cosas añadidas para la escritura vectorial----------- */
+/* segmento de una escritura vectorial (escribirv) */
+#define MAX_SEGMENTOS 16	/* maximo de segmentos por llamada */
+
+struct segmento {
+	char *texto;			/* direccion del segmento */
+	unsigned int longi;		/* longitud en bytes */
+};
+
+/* -----------cosas añadidas para estadisticas de llamadas----------- */
+/* contadores de una llamada al sistema. La latencia se mide en ticks y se
+   acumula en un histograma logaritmico: la cubeta 0 cuenta las llamadas de
+   0 ticks y la cubeta i (i>0) las de [2^(i-1), 2^i) ticks; la ultima
+   recoge ademas todas las mas largas */
+#define NUM_CUBETAS_LATENCIA 12
+
+struct estad_llamada {
+	unsigned long llamadas;		/* veces que se ha invocado */
+	unsigned long errores;		/* veces que ha devuelto un valor negativo */
+	unsigned long latencia[NUM_CUBETAS_LATENCIA];	/* histograma de duracion */
+};
+
+/* numero de cada llamada al sistema, para obtener_estad_llamadas. Deben
+   coincidir con los de minikernel/include/llamsis.h (lo comprueba serv.c
+   al compilar) */
+#define NUM_LLAMADAS 40
+#define LLAMADA_CREAR_PROCESO 0
+#define LLAMADA_TERMINAR_PROCESO 1
+#define LLAMADA_ESCRIBIR 2
+#define LLAMADA_OBTENERID 3
+#define LLAMADA_DORMIR 4
+#define LLAMADA_CREAR_MUTEX 5
+#define LLAMADA_ABRIR_MUTEX 6
+#define LLAMADA_LOCK 7
+#define LLAMADA_UNLOCK 8
+#define LLAMADA_CERRAR_MUTEX 9
+#define LLAMADA_FIJAR_PRIORIDAD 10
+#define LLAMADA_CREAR_PROCESOS 11
+#define LLAMADA_CREAR_HILO 12
+#define LLAMADA_DATOS_HILO 13
+#define LLAMADA_TIEMPOS_PROCESO 14
+#define LLAMADA_REGISTRAR_ANILLO 15
+#define LLAMADA_ENTRAR_ANILLO 16
+#define LLAMADA_OBTENER_INFO_KERNEL 17
+#define LLAMADA_OBTENER_ESTAD_LLAMADAS 18
+#define LLAMADA_ESCRIBIRV 19
+#define LLAMADA_ESTAD_MUTEX 20
+#define LLAMADA_CREAR_COND 21
+#define LLAMADA_ABRIR_COND 22
+#define LLAMADA_ESPERAR_COND 23
+#define LLAMADA_SENALAR_COND 24
+#define LLAMADA_DIFUNDIR_COND 25
+#define LLAMADA_CERRAR_COND 26
+#define LLAMADA_CREAR_RW 27
+#define LLAMADA_ABRIR_RW 28
+#define LLAMADA_LOCK_LECTURA 29
+#define LLAMADA_LOCK_ESCRITURA 30
+#define LLAMADA_UNLOCK_RW 31
+#define LLAMADA_CERRAR_RW 32
+#define LLAMADA_CREAR_SEM 33
+#define LLAMADA_ABRIR_SEM 34
+#define LLAMADA_ESPERAR_SEM 35
+#define LLAMADA_SENALAR_SEM 36
+#define LLAMADA_CERRAR_SEM 37
+#define LLAMADA_LOCK_TEMPORIZADO 38
+#define LLAMADA_SERIE_VIVA 39
+
+/* -----------cosas añadidas para el anillo de llamadas----------- */
+/* tipos del anillo compartido con el que un proceso encola varias llamadas
+   al sistema y las hace tratar con una sola entrada al kernel */
+#define TAM_ANILLO 64		/* entradas de cada cola del anillo */
+
+struct peticion_llamada {
+	int servicio;			/* numero de la llamada */
+	long args[3];			/* parametros de la llamada */
+	long dato;				/* dato del usuario que se copia al resultado */
+};
+
+struct resultado_llamada {
+	long dato;				/* dato de la peticion correspondiente */
+	int resultado;			/* valor devuelto por la llamada */
+};
+
+struct anillo_llamadas {
+	unsigned int cab_pet;	/* siguiente peticion a tratar (la avanza el kernel) */
+	unsigned int cola_pet;	/* siguiente peticion libre (la avanza el usuario) */
+	unsigned int cab_res;	/* siguiente resultado a leer (la avanza el usuario) */
+	unsigned int cola_res;	/* siguiente resultado libre (la avanza el kernel) */
+	struct peticion_llamada peticiones[TAM_ANILLO];
+	struct resultado_llamada resultados[TAM_ANILLO];
+};
 
 /* Evita el uso del printf de la bilioteca est�ndar */
 #define printf escribirf
@@ -40,8 +192,55 @@ int dormir(unsigned int segundos);
 int crear_mutex(char *nombre, int tipo);
 int abrir_mutex(char *nombre);
 int lock(unsigned int mutexid);
+int lock_temporizado(unsigned int mutexid, unsigned int ticks);
 int unlock(unsigned int mutexid);
 int cerrar_mutex(unsigned int mutexid);
+int estad_mutex(unsigned int mutexid, struct estad_mutex *estad);
+int crear_cond(char *nombre);
+int abrir_cond(char *nombre);
+int esperar_cond(unsigned int condid, unsigned int mutexid);
+int senalar_cond(unsigned int condid);
+int difundir_cond(unsigned int condid);
+int cerrar_cond(unsigned int condid);
+int crear_rw(char *nombre);
+int abrir_rw(char *nombre);
+int lock_lectura(unsigned int rwid);
+int lock_escritura(unsigned int rwid);
+int unlock_rw(unsigned int rwid);
+int cerrar_rw(unsigned int rwid);
+int crear_sem(char *nombre, int valor);
+int abrir_sem(char *nombre);
+int esperar_sem(unsigned int semid, int n);
+int senalar_sem(unsigned int semid, int n);
+int cerrar_sem(unsigned int semid);
+int fijar_prioridad(unsigned int prioridad);
+int crear_procesos(char *prog, unsigned int n, int *ids);
+int crear_hilo(void (*funcion)(void *), void *arg);
+int tiempos_proceso(struct tiempos_ejec *tiempos);
+int registrar_anillo(struct anillo_llamadas *anillo);
+int entrar_anillo();
+int obtener_info_kernel(struct info_kernel **pagina);
+int obtener_estad_llamadas(int servicio, struct estad_llamada *estad, int solo_proceso);
+int escribirv(struct segmento *segs, unsigned int n);
+
+/* funciones de biblioteca que leen la pagina de informacion sin entrar al kernel */
+unsigned long obtener_ticks();
+
+/* funciones de biblioteca para la salida con buffer: la salida pendiente se
+   vuelca tambien en dormir y terminar_proceso. fijar_modo_salida devuelve
+   -1 si el modo no es valido o si el proceso no tiene buffer por haber ya
+   NUM_DATOS_PROCESOS procesos vivos de su programa con el */
+int fijar_modo_salida(int modo);
+int vaciar_salida();
+
+/* funciones de biblioteca que encolan llamadas en el anillo: devuelven -1 si
+   esta lleno. Los resultados se recogen con anillo_resultado */
+int anillo_escribir(struct anillo_llamadas *anillo, long dato, char *texto, unsigned int longi);
+int anillo_obtener_id_pr(struct anillo_llamadas *anillo, long dato);
+int anillo_dormir(struct anillo_llamadas *anillo, long dato, unsigned int segundos);
+int anillo_lock(struct anillo_llamadas *anillo, long dato, unsigned int mutexid);
+int anillo_unlock(struct anillo_llamadas *anillo, long dato, unsigned int mutexid);
+int anillo_resultado(struct anillo_llamadas *anillo, long *dato, int *resultado);
 
 #endif /* SERVICIOS_H */
 
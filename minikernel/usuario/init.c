@@ -83,6 +83,91 @@ ALGO COMENTE ESTA PARTE Y DESCOMENTE LA PRUEBA CORRESPONDIENTE */
 		printf("Error creando prueba_RR2\n");
 
 
+/* PRUEBA DE PRIORIDADES
+	if (crear_proceso("prueba_prioridad")<0)
+		printf("Error creando prueba_prioridad\n");
+*/
+
+/* PRUEBA DE CREACION DE PROCESOS POR LOTES
+	if (crear_proceso("prueba_lote")<0)
+		printf("Error creando prueba_lote\n");
+*/
+
+/* PRUEBA DE HILOS
+	if (crear_proceso("prueba_hilos")<0)
+		printf("Error creando prueba_hilos\n");
+*/
+
+/* PRUEBA DEL ANILLO DE LLAMADAS
+	if (crear_proceso("prueba_anillo")<0)
+		printf("Error creando prueba_anillo\n");
+*/
+
+/* PRUEBA DE LA PAGINA DE INFORMACION DEL KERNEL
+	if (crear_proceso("prueba_info")<0)
+		printf("Error creando prueba_info\n");
+*/
+
+/* PRUEBA DE ESTADISTICAS DE LLAMADAS
+	if (crear_proceso("prueba_estad")<0)
+		printf("Error creando prueba_estad\n");
+*/
+
+/* PRUEBA DE ESCRITURA VECTORIAL
+	if (crear_proceso("prueba_escribirv")<0)
+		printf("Error creando prueba_escribirv\n");
+*/
+
+/* PRUEBA DEL ESPACIO DE NOMBRES DE MUTEX
+	if (crear_proceso("prueba_nombres")<0)
+		printf("Error creando prueba_nombres\n");
+*/
+
+/* PRUEBA DEL CAMINO RAPIDO DE MUTEX
+	if (crear_proceso("prueba_futex")<0)
+		printf("Error creando prueba_futex\n");
+*/
+
+/* PRUEBA DE TRASPASO DE MUTEX
+	if (crear_proceso("prueba_traspaso")<0)
+		printf("Error creando prueba_traspaso\n");
+*/
+
+/* PRUEBA DE VARIABLES CONDICION
+	if (crear_proceso("prueba_cond")<0)
+		printf("Error creando prueba_cond\n");
+*/
+
+/* PRUEBA DE CERROJOS DE LECTURA/ESCRITURA
+	if (crear_proceso("prueba_rw")<0)
+		printf("Error creando prueba_rw\n");
+*/
+
+/* PRUEBA DE SEMAFOROS
+	if (crear_proceso("prueba_sem")<0)
+		printf("Error creando prueba_sem\n");
+*/
+
+/* PRUEBA DE LOCK TEMPORIZADO
+	if (crear_proceso("prueba_temporizado")<0)
+		printf("Error creando prueba_temporizado\n");
+*/
+
+/* PRUEBA DE HERENCIA DE PRIORIDAD
+	if (crear_proceso("prueba_herencia")<0)
+		printf("Error creando prueba_herencia\n");
+*/
+
+/* PRUEBA DE DETECCION DE INTERBLOQUEOS
+	if (crear_proceso("prueba_interbloqueo")<0)
+		printf("Error creando prueba_interbloqueo\n");
+*/
+
+/* PRUEBA DE RECUPERACION DE DATOS DE PROCESOS ABORTADOS
+	if (crear_proceso("prueba_abortos")<0)
+		printf("Error creando prueba_abortos\n");
+*/
+
 /* PRUEBA DEL TERMINAL
 	if (crear_proceso("prueba_term")<0)
 		printf("Error creando prueba_term\n");
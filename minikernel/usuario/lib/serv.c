@@ -19,6 +19,39 @@
 #include "llamsis.h"
 #include "servicios.h"
 
+/* los numeros de llamada que servicios.h exporta a los programas deben
+   coincidir con los del kernel */
+#if NUM_LLAMADAS!=NSERVICIOS || LLAMADA_CREAR_PROCESO!=CREAR_PROCESO || \
+	LLAMADA_TERMINAR_PROCESO!=TERMINAR_PROCESO || \
+	LLAMADA_ESCRIBIR!=ESCRIBIR || LLAMADA_OBTENERID!=OBTENERID || \
+	LLAMADA_DORMIR!=DORMIR || LLAMADA_CREAR_MUTEX!=CREAR_MUTEX || \
+	LLAMADA_ABRIR_MUTEX!=ABRIR_MUTEX || LLAMADA_LOCK!=LOCK || \
+	LLAMADA_UNLOCK!=UNLOCK || LLAMADA_CERRAR_MUTEX!=CERRAR_MUTEX || \
+	LLAMADA_FIJAR_PRIORIDAD!=FIJAR_PRIORIDAD || \
+	LLAMADA_CREAR_PROCESOS!=CREAR_PROCESOS || \
+	LLAMADA_CREAR_HILO!=CREAR_HILO || LLAMADA_DATOS_HILO!=DATOS_HILO || \
+	LLAMADA_TIEMPOS_PROCESO!=TIEMPOS_PROCESO || \
+	LLAMADA_REGISTRAR_ANILLO!=REGISTRAR_ANILLO || \
+	LLAMADA_ENTRAR_ANILLO!=ENTRAR_ANILLO || \
+	LLAMADA_OBTENER_INFO_KERNEL!=OBTENER_INFO_KERNEL || \
+	LLAMADA_OBTENER_ESTAD_LLAMADAS!=OBTENER_ESTAD_LLAMADAS || \
+	LLAMADA_ESCRIBIRV!=ESCRIBIRV || LLAMADA_ESTAD_MUTEX!=ESTAD_MUTEX || \
+	LLAMADA_CREAR_COND!=CREAR_COND || LLAMADA_ABRIR_COND!=ABRIR_COND || \
+	LLAMADA_ESPERAR_COND!=ESPERAR_COND || \
+	LLAMADA_SENALAR_COND!=SENALAR_COND || \
+	LLAMADA_DIFUNDIR_COND!=DIFUNDIR_COND || \
+	LLAMADA_CERRAR_COND!=CERRAR_COND || LLAMADA_CREAR_RW!=CREAR_RW || \
+	LLAMADA_ABRIR_RW!=ABRIR_RW || LLAMADA_LOCK_LECTURA!=LOCK_LECTURA || \
+	LLAMADA_LOCK_ESCRITURA!=LOCK_ESCRITURA || \
+	LLAMADA_UNLOCK_RW!=UNLOCK_RW || LLAMADA_CERRAR_RW!=CERRAR_RW || \
+	LLAMADA_CREAR_SEM!=CREAR_SEM || LLAMADA_ABRIR_SEM!=ABRIR_SEM || \
+	LLAMADA_ESPERAR_SEM!=ESPERAR_SEM || LLAMADA_SENALAR_SEM!=SENALAR_SEM || \
+	LLAMADA_CERRAR_SEM!=CERRAR_SEM || \
+	LLAMADA_LOCK_TEMPORIZADO!=LOCK_TEMPORIZADO || \
+	LLAMADA_SERIE_VIVA!=SERIE_VIVA
+#error "numeros LLAMADA_* de servicios.h distintos de los de llamsis.h"
+#endif
+
 /* Funci�n del m�dulo "misc" que prepara el c�digo de la llamada
    (en el registro 0), los par�metros (en registros 1, 2, ...), realiza la
    instruccion de llamada al sistema  y devuelve el resultado 
@@ -26,6 +59,111 @@
 
 int llamsis(int llamada, int nargs, ... /* args */);
 
+/* pagina de informacion del kernel: se pide la primera vez que se usa */
+static struct info_kernel *info_kernel=0;
+
+static struct info_kernel *pagina_info(){
+	if (info_kernel==0)
+		obtener_info_kernel(&info_kernel);
+	return info_kernel;
+}
+
+/*
+ * Datos de cada proceso en la biblioteca: salida con buffer de escribir y
+ * palabras de los mutex abiertos. Los procesos de un mismo programa
+ * comparten las variables globales de la biblioteca, por lo que cada
+ * proceso usa una entrada de la tabla identificada por su numero de serie.
+ * Un proceso abortado por una excepcion no libera su entrada, por lo que,
+ * si no queda ninguna libre, se recupera la de un proceso que ya no existe.
+ * Si tampoco la hay el proceso escribe sin buffer y hace siempre las
+ * llamadas de mutex, y fijar_modo_salida se lo indica devolviendo -1.
+ */
+#define TAM_BUFFER_SALIDA 4096
+
+struct datos_proceso {
+	unsigned long serie;		/* proceso que la usa (0 si libre) */
+	int modo;					/* modo de la salida */
+	unsigned int lon;			/* bytes pendientes en buffer */
+	char buffer[TAM_BUFFER_SALIDA];
+	struct palabra_mutex *palabras[NUM_MUT_PROC];	/* palabra de cada descriptor (0 si cerrado) */
+};
+
+static struct datos_proceso datos_procesos[NUM_DATOS_PROCESOS];
+
+/* deja la entrada lista para un proceso que empieza a usarla */
+static struct datos_proceso *iniciar_datos_proceso(struct datos_proceso *d){
+	int j;
+
+	d->modo=SALIDA_POR_LINEAS;
+	d->lon=0;
+	for (j=0; j<NUM_MUT_PROC; j++)
+		d->palabras[j]=0;
+	return d;
+}
+
+/* devuelve los datos del proceso actual, reservandolos si no tenia (0 si no hay) */
+static struct datos_proceso *datos_proceso(){
+	struct info_kernel *info=pagina_info();
+	unsigned long serie, otra;
+	int i;
+
+	if (info==0)
+		return 0;
+	serie=info->serie_proceso;
+	for (i=0; i<NUM_DATOS_PROCESOS; i++)
+		if (datos_procesos[i].serie==serie)
+			return &datos_procesos[i];
+
+	/* la reserva es atomica porque otro proceso del programa puede expulsarnos */
+	for (i=0; i<NUM_DATOS_PROCESOS; i++)
+		if (datos_procesos[i].serie==0 &&
+			__sync_bool_compare_and_swap(&datos_procesos[i].serie, 0, serie))
+			return iniciar_datos_proceso(&datos_procesos[i]);
+
+	/* recupera la de un proceso que termino sin liberarla; su salida
+	   pendiente se pierde, como la de cualquier proceso abortado */
+	for (i=0; i<NUM_DATOS_PROCESOS; i++)
+		if ((otra=datos_procesos[i].serie)!=0 &&
+			llamsis(SERIE_VIVA, 1, (long)otra)==0 &&
+			__sync_bool_compare_and_swap(&datos_procesos[i].serie, otra, serie))
+			return iniciar_datos_proceso(&datos_procesos[i]);
+	return 0;
+}
+
+static void vaciar(struct datos_proceso *s){
+	if (s->lon>0)
+		llamsis(ESCRIBIR, 2, (long)s->buffer, (long)s->lon);
+	s->lon=0;
+}
+
+/* vuelca la salida pendiente y deja libre la entrada del proceso */
+static void liberar_datos_proceso(){
+	struct datos_proceso *s=datos_proceso();
+
+	if (s)
+	{
+		vaciar(s);
+		s->serie=0;
+	}
+}
+
+/* palabra del mutex asociado a un descriptor (0 si no se conoce) */
+static struct palabra_mutex *palabra_mutex(unsigned int mutexid){
+	struct datos_proceso *d;
+
+	if (mutexid>=NUM_MUT_PROC || (d=datos_proceso())==0)
+		return 0;
+	return d->palabras[mutexid];
+}
+
+/* guarda la palabra de un descriptor recien abierto */
+static int anotar_palabra(int desc, struct palabra_mutex *palabra){
+	struct datos_proceso *d;
+
+	if (desc>=0 && desc<NUM_MUT_PROC && (d=datos_proceso())!=0)
+		d->palabras[desc]=palabra;
+	return desc;
+}
 
 /*
  *
@@ -38,35 +176,311 @@ int crear_proceso(char *prog){
 	return llamsis(CREAR_PROCESO, 1, (long)prog);
 }
 int terminar_proceso(){
+	liberar_datos_proceso();
 	return llamsis(TERMINAR_PROCESO, 0);
 }
 int escribir(char *texto, unsigned int longi){
-	return llamsis(ESCRIBIR, 2, (long)texto, (long)longi);
+	struct datos_proceso *s=datos_proceso();
+	unsigned int i;
+
+	if (s==0 || s->modo==SALIDA_SIN_BUFFER)
+		return llamsis(ESCRIBIR, 2, (long)texto, (long)longi);
+
+	if (s->lon+longi>TAM_BUFFER_SALIDA)
+	{
+		vaciar(s);
+		/* lo que no cabe ni en el buffer vacio se escribe directamente */
+		if (longi>TAM_BUFFER_SALIDA)
+			return llamsis(ESCRIBIR, 2, (long)texto, (long)longi);
+	}
+	for (i=0; i<longi; i++)
+		s->buffer[s->lon++]=texto[i];
+
+	if (s->lon==TAM_BUFFER_SALIDA ||
+		(s->modo==SALIDA_POR_LINEAS && longi>0 && texto[longi-1]=='\n'))
+		vaciar(s);
+	return 0;
 }
 /* funciones añadidas */
 int obtener_id_pr(){
-	return llamsis(OBTENERID, 0);
+	struct info_kernel *info=pagina_info();
+
+	if (info==0)
+		return llamsis(OBTENERID, 0);
+	return info->id_proceso;
 }
 int dormir(unsigned int segundos){
+	vaciar_salida();
 	return llamsis(DORMIR, 1, (long)segundos);
 }
 
 int crear_mutex(char *nombre, int tipo){
-	return llamsis(CREAR_MUTEX, 2, (long)nombre, (long)tipo);
+	struct palabra_mutex *palabra=0;
+	int desc;
+
+	desc=llamsis(CREAR_MUTEX, 3, (long)nombre, (long)tipo, (long)&palabra);
+	return anotar_palabra(desc, palabra);
 }
 
 int abrir_mutex(char *nombre){
-	return llamsis(ABRIR_MUTEX, 1, (long)nombre);
+	struct palabra_mutex *palabra=0;
+	int desc;
+
+	desc=llamsis(ABRIR_MUTEX, 2, (long)nombre, (long)&palabra);
+	return anotar_palabra(desc, palabra);
+}
+
+/* sin contienda lock y unlock solo modifican la palabra del mutex; si esta
+   ocupado por otro proceso, o hay procesos esperando, se llama al kernel.
+   El kernel mantiene el bit de espera mientras quede alguien en la lista,
+   por lo que ni el CAS de lock (desde 0) ni el de unlock (desde id+1)
+   pueden tener exito dejando a un proceso sin despertar */
+/* intenta bloquear el mutex sobre su palabra sin entrar al kernel,
+   devuelve 0 si lo consigue */
+static int lock_rapido(unsigned int mutexid){
+	struct palabra_mutex *p=palabra_mutex(mutexid);
+	int yo;
+
+	if (p)
+	{
+		yo=obtener_id_pr()+1;
+		if (__sync_bool_compare_and_swap(&p->estado, 0, yo))
+		{
+			p->contador=1;
+			return 0;
+		}
+		/* bloqueo recursivo por el propietario */
+		if ((p->estado&MUTEX_PROPIETARIO)==yo && (p->tipo&RECURSIVO))
+		{
+			p->contador++;
+			return 0;
+		}
+	}
+	return -1;
 }
 
 int lock(unsigned int mutexid){
+	if (lock_rapido(mutexid)==0)
+		return 0;
 	return llamsis(LOCK, 1, (long)mutexid);
 }
 
+int lock_temporizado(unsigned int mutexid, unsigned int ticks){
+	if (lock_rapido(mutexid)==0)
+		return 0;
+	return llamsis(LOCK_TEMPORIZADO, 2, (long)mutexid, (long)ticks);
+}
+
 int unlock(unsigned int mutexid){
+	struct palabra_mutex *p=palabra_mutex(mutexid);
+	int yo;
+
+	if (p && p->estado==(yo=obtener_id_pr()+1))
+	{
+		if (p->contador>1)
+		{
+			p->contador--;
+			return 0;
+		}
+		/* si entretanto alguien se ha puesto a esperar lo despierta el kernel */
+		p->contador=0;
+		if (__sync_bool_compare_and_swap(&p->estado, yo, 0))
+			return 0;
+		p->contador=1;
+	}
 	return llamsis(UNLOCK, 1, (long)mutexid);
 }
 
 int cerrar_mutex(unsigned int mutexid){
+	anotar_palabra(mutexid, 0);
 	return llamsis(CERRAR_MUTEX, 1, (long)mutexid);
 }
+
+int estad_mutex(unsigned int mutexid, struct estad_mutex *estad){
+	return llamsis(ESTAD_MUTEX, 2, (long)mutexid, (long)estad);
+}
+
+int crear_cond(char *nombre){
+	return llamsis(CREAR_COND, 1, (long)nombre);
+}
+int abrir_cond(char *nombre){
+	return llamsis(ABRIR_COND, 1, (long)nombre);
+}
+int esperar_cond(unsigned int condid, unsigned int mutexid){
+	return llamsis(ESPERAR_COND, 2, (long)condid, (long)mutexid);
+}
+int senalar_cond(unsigned int condid){
+	return llamsis(SENALAR_COND, 1, (long)condid);
+}
+int difundir_cond(unsigned int condid){
+	return llamsis(DIFUNDIR_COND, 1, (long)condid);
+}
+int cerrar_cond(unsigned int condid){
+	return llamsis(CERRAR_COND, 1, (long)condid);
+}
+
+int crear_rw(char *nombre){
+	return llamsis(CREAR_RW, 1, (long)nombre);
+}
+int abrir_rw(char *nombre){
+	return llamsis(ABRIR_RW, 1, (long)nombre);
+}
+int lock_lectura(unsigned int rwid){
+	return llamsis(LOCK_LECTURA, 1, (long)rwid);
+}
+int lock_escritura(unsigned int rwid){
+	return llamsis(LOCK_ESCRITURA, 1, (long)rwid);
+}
+int unlock_rw(unsigned int rwid){
+	return llamsis(UNLOCK_RW, 1, (long)rwid);
+}
+int cerrar_rw(unsigned int rwid){
+	return llamsis(CERRAR_RW, 1, (long)rwid);
+}
+
+int crear_sem(char *nombre, int valor){
+	return llamsis(CREAR_SEM, 2, (long)nombre, (long)valor);
+}
+int abrir_sem(char *nombre){
+	return llamsis(ABRIR_SEM, 1, (long)nombre);
+}
+int esperar_sem(unsigned int semid, int n){
+	return llamsis(ESPERAR_SEM, 2, (long)semid, (long)n);
+}
+int senalar_sem(unsigned int semid, int n){
+	return llamsis(SENALAR_SEM, 2, (long)semid, (long)n);
+}
+int cerrar_sem(unsigned int semid){
+	return llamsis(CERRAR_SEM, 1, (long)semid);
+}
+
+int fijar_prioridad(unsigned int prioridad){
+	return llamsis(FIJAR_PRIORIDAD, 1, (long)prioridad);
+}
+
+int crear_procesos(char *prog, unsigned int n, int *ids){
+	return llamsis(CREAR_PROCESOS, 3, (long)prog, (long)n, (long)ids);
+}
+
+/* punto de arranque de los hilos: obtiene la funcion y su argumento y la
+   ejecuta; al volver, start invoca terminar_proceso */
+static void lanzadera_hilo(){
+	void (*funcion)(void *);
+	void *arg;
+
+	if (llamsis(DATOS_HILO, 2, (long)&funcion, (long)&arg)==0)
+		funcion(arg);
+}
+
+int crear_hilo(void (*funcion)(void *), void *arg){
+	return llamsis(CREAR_HILO, 3, (long)lanzadera_hilo, (long)funcion, (long)arg);
+}
+
+int tiempos_proceso(struct tiempos_ejec *tiempos){
+	return llamsis(TIEMPOS_PROCESO, 1, (long)tiempos);
+}
+
+int registrar_anillo(struct anillo_llamadas *anillo){
+	anillo->cab_pet=anillo->cola_pet=0;
+	anillo->cab_res=anillo->cola_res=0;
+	return llamsis(REGISTRAR_ANILLO, 1, (long)anillo);
+}
+
+int entrar_anillo(){
+	return llamsis(ENTRAR_ANILLO, 0);
+}
+
+/* encola una peticion en el anillo sin entrar al kernel */
+static int encolar_peticion(struct anillo_llamadas *anillo, int servicio,
+	long dato, long arg1, long arg2){
+	struct peticion_llamada *pet;
+
+	if (anillo->cola_pet-anillo->cab_pet==TAM_ANILLO)
+		return -1;	/* anillo lleno */
+	pet=&anillo->peticiones[anillo->cola_pet%TAM_ANILLO];
+	pet->servicio=servicio;
+	pet->args[0]=arg1;
+	pet->args[1]=arg2;
+	pet->args[2]=0;
+	pet->dato=dato;
+	anillo->cola_pet++;
+	return 0;
+}
+
+int anillo_escribir(struct anillo_llamadas *anillo, long dato, char *texto, unsigned int longi){
+	return encolar_peticion(anillo, ESCRIBIR, dato, (long)texto, (long)longi);
+}
+
+int anillo_obtener_id_pr(struct anillo_llamadas *anillo, long dato){
+	return encolar_peticion(anillo, OBTENERID, dato, 0, 0);
+}
+
+int anillo_dormir(struct anillo_llamadas *anillo, long dato, unsigned int segundos){
+	return encolar_peticion(anillo, DORMIR, dato, (long)segundos, 0);
+}
+
+int anillo_lock(struct anillo_llamadas *anillo, long dato, unsigned int mutexid){
+	return encolar_peticion(anillo, LOCK, dato, (long)mutexid, 0);
+}
+
+int anillo_unlock(struct anillo_llamadas *anillo, long dato, unsigned int mutexid){
+	return encolar_peticion(anillo, UNLOCK, dato, (long)mutexid, 0);
+}
+
+/* recoge el siguiente resultado del anillo: devuelve -1 si no hay ninguno */
+int anillo_resultado(struct anillo_llamadas *anillo, long *dato, int *resultado){
+	struct resultado_llamada *res;
+
+	if (anillo->cab_res==anillo->cola_res)
+		return -1;
+	res=&anillo->resultados[anillo->cab_res%TAM_ANILLO];
+	*dato=res->dato;
+	*resultado=res->resultado;
+	anillo->cab_res++;
+	return 0;
+}
+
+int obtener_info_kernel(struct info_kernel **pagina){
+	return llamsis(OBTENER_INFO_KERNEL, 1, (long)pagina);
+}
+
+/* lee el tick actual de la pagina de informacion, sin llamada al sistema */
+unsigned long obtener_ticks(){
+	struct info_kernel *info=pagina_info();
+
+	return info ? info->ticks : 0;
+}
+
+int obtener_estad_llamadas(int servicio, struct estad_llamada *estad, int solo_proceso){
+	return llamsis(OBTENER_ESTAD_LLAMADAS, 3, (long)servicio, (long)estad, (long)solo_proceso);
+}
+
+/* fija el modo de la salida del proceso, devuelve el previo */
+int fijar_modo_salida(int modo){
+	struct datos_proceso *s;
+	int previo;
+
+	if (modo<SALIDA_SIN_BUFFER || modo>SALIDA_COMPLETA)
+		return -1;
+	if ((s=datos_proceso())==0)
+		return -1;
+	vaciar(s);
+	previo=s->modo;
+	s->modo=modo;
+	return previo;
+}
+
+/* vuelca la salida pendiente del proceso */
+int vaciar_salida(){
+	struct datos_proceso *s=datos_proceso();
+
+	if (s)
+		vaciar(s);
+	return 0;
+}
+
+/* escribe varios segmentos con una sola llamada, tras volcar la salida pendiente */
+int escribirv(struct segmento *segs, unsigned int n){
+	vaciar_salida();
+	return llamsis(ESCRIBIRV, 2, (long)segs, (long)n);
+}
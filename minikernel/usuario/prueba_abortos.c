@@ -0,0 +1,52 @@
+/*
+ * usuario/prueba_abortos.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que prueba que la biblioteca recupera los datos de
+ * los procesos abortados por una excepcion: crea, de uno en uno, mas
+ * hijos de los que caben en su tabla y cada uno reserva su entrada
+ * fijando el modo de salida antes de dividir por cero
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+#define NUM_HIJOS 12	/* mas que entradas tiene la tabla de la biblioteca */
+
+int creado=0;
+volatile int hijo=0;
+volatile int cero=0;
+
+int main(){
+	int i, n;
+
+	if (creado)
+	{
+		n=hijo;
+		if (fijar_modo_salida(SALIDA_POR_LINEAS)<0)
+			printf("error: hijo %d sin datos en la biblioteca. NO DEBE APARECER\n", n);
+		else
+			printf("prueba_abortos: hijo %d aborta\n", n);
+		n/=cero;
+		printf("error: hijo %d no aborta. NO DEBE APARECER\n", n);
+		return 0;
+	}
+
+	creado=1;
+	printf("prueba_abortos: comienza\n");
+	for (i=0; i<NUM_HIJOS; i++)
+	{
+		hijo=i;
+		if (crear_proceso("prueba_abortos")<0)
+			printf("error creando hijo %d. NO DEBE APARECER\n", i);
+		dormir(1);
+	}
+	if (fijar_modo_salida(SALIDA_POR_LINEAS)<0)
+		printf("error: padre sin datos en la biblioteca. NO DEBE APARECER\n");
+	printf("prueba_abortos: termina\n");
+	return 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * usuario/prueba_anillo.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que realiza una prueba del anillo de llamadas:
+ * encola varias llamadas y las hace tratar con una sola entrada al kernel
+ */
+
+#include "servicios.h"
+
+#define NUM_ESCRITURAS 10
+
+struct anillo_llamadas anillo;
+
+int main(){
+	int i, n, res;
+	long dato;
+	char mensaje[]="prueba_anillo: escritura encolada\n";
+
+	printf("prueba_anillo: comienza\n");
+
+	if (registrar_anillo(&anillo)<0)
+		printf("error registrando anillo. NO DEBE APARECER\n");
+
+	for (i=0; i<NUM_ESCRITURAS; i++)
+		anillo_escribir(&anillo, i, mensaje, sizeof(mensaje)-1);
+	anillo_obtener_id_pr(&anillo, NUM_ESCRITURAS);
+
+	/* lock de un mutex inexistente: su resultado debe ser negativo */
+	anillo_lock(&anillo, NUM_ESCRITURAS+1, 1000);
+
+	if ((n=entrar_anillo())!=NUM_ESCRITURAS+2)
+		printf("error: tratadas %d peticiones. NO DEBE APARECER\n", n);
+
+	while (anillo_resultado(&anillo, &dato, &res)==0)
+		if (dato==NUM_ESCRITURAS && res!=obtener_id_pr())
+			printf("error: id %d incorrecto. NO DEBE APARECER\n", res);
+		else if (dato==NUM_ESCRITURAS+1 && res>=0)
+			printf("error: lock de mutex inexistente. NO DEBE APARECER\n");
+
+	printf("prueba_anillo: termina\n");
+	return 0;
+}
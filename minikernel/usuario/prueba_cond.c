@@ -0,0 +1,143 @@
+/*
+ * usuario/prueba_cond.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que prueba las variables condicion con un
+ * productor y dos consumidores sobre un buffer circular compartido: los
+ * procesos esperan en las condiciones en vez de sondear con dormir
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+#define NUM_CONSUMIDORES 2
+#define NUM_DATOS 200
+#define TAM_BUFFER 4
+
+int creados=0;
+int buffer[TAM_BUFFER];
+int primero=0, num_datos=0, fin=0;
+long suma=0;
+int consumidos[NUM_CONSUMIDORES+1];
+int terminados=0;
+int acabados=0;
+
+static void productor(int mutex, int hueco, int dato){
+	int i;
+
+	/* sin tener el mutex no se puede esperar */
+	if (esperar_cond(hueco, mutex)>=0)
+		printf("esperar_cond sin mutex. NO DEBE APARECER\n");
+
+	for (i=1; i<=NUM_DATOS; i++)
+	{
+		lock(mutex);
+		while (num_datos==TAM_BUFFER)
+			if (esperar_cond(hueco, mutex)<0)
+				printf("error en esperar_cond. NO DEBE APARECER\n");
+		buffer[(primero+num_datos)%TAM_BUFFER]=i;
+		num_datos++;
+		senalar_cond(dato);
+		unlock(mutex);
+	}
+
+	/* despierta a todos los consumidores para que vean el fin */
+	lock(mutex);
+	fin=1;
+	difundir_cond(dato);
+	unlock(mutex);
+}
+
+static void consumidor(int n, int mutex, int hueco, int dato){
+	for (;;)
+	{
+		lock(mutex);
+		while (num_datos==0 && !fin)
+			if (esperar_cond(dato, mutex)<0)
+				printf("error en esperar_cond. NO DEBE APARECER\n");
+		if (num_datos==0)
+		{
+			unlock(mutex);
+			break;
+		}
+		suma+=buffer[primero];
+		primero=(primero+1)%TAM_BUFFER;
+		num_datos--;
+		consumidos[n]++;
+		senalar_cond(hueco);
+		unlock(mutex);
+	}
+}
+
+int main(){
+	int n, mutex, hueco, dato;
+
+	if (creados==0)
+	{
+		creados=1;
+		if ((mutex=crear_mutex("buffer", NO_RECURSIVO))<0)
+			printf("error creando mutex. NO DEBE APARECER\n");
+		if ((hueco=crear_cond("hueco"))<0)
+			printf("error creando hueco. NO DEBE APARECER\n");
+		if ((dato=crear_cond("dato"))<0)
+			printf("error creando dato. NO DEBE APARECER\n");
+
+		/* condiciones y mutex comparten nombres pero no se mezclan */
+		if (crear_mutex("dato", NO_RECURSIVO)>=0)
+			printf("mutex con nombre de condicion. NO DEBE APARECER\n");
+		if (lock(dato)>=0)
+			printf("lock de una condicion. NO DEBE APARECER\n");
+		if (senalar_cond(mutex)>=0)
+			printf("senalar_cond de un mutex. NO DEBE APARECER\n");
+
+		while (creados<=NUM_CONSUMIDORES)
+		{
+			creados++;
+			if (crear_proceso("prueba_cond")<0)
+				printf("error creando proceso. NO DEBE APARECER\n");
+		}
+		productor(mutex, hueco, dato);
+		n=0;
+	}
+	else
+	{
+		if ((mutex=abrir_mutex("buffer"))<0)
+			printf("error abriendo mutex. NO DEBE APARECER\n");
+		if ((hueco=abrir_cond("hueco"))<0)
+			printf("error abriendo hueco. NO DEBE APARECER\n");
+		if ((dato=abrir_cond("dato"))<0)
+			printf("error abriendo dato. NO DEBE APARECER\n");
+		if (abrir_mutex("hueco")>=0)
+			printf("abrir_mutex de una condicion. NO DEBE APARECER\n");
+
+		lock(mutex);
+		n=++terminados;
+		unlock(mutex);
+		consumidor(n, mutex, hueco, dato);
+	}
+
+	cerrar_cond(hueco);
+	cerrar_cond(dato);
+	if (cerrar_cond(mutex)>=0)
+		printf("cerrar_cond de un mutex. NO DEBE APARECER\n");
+
+	/* el ultimo consumidor comprueba lo recibido */
+	if (n!=0)
+	{
+		lock(mutex);
+		n=++acabados;
+		unlock(mutex);
+	}
+	if (n==NUM_CONSUMIDORES)
+	{
+		if (suma!=(long)NUM_DATOS*(NUM_DATOS+1)/2)
+			printf("error: suma %ld. NO DEBE APARECER\n", suma);
+		else
+			printf("prueba_cond: consumidos %d datos, suma %ld\n", consumidos[1]+consumidos[2], suma);
+	}
+	return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * usuario/prueba_escribirv.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que realiza una prueba de la llamada escribirv
+ */
+
+#include "servicios.h"
+
+static char cabecera[]="prueba_escribirv: [";
+static char contenido[]="cabecera, contenido y cola en una llamada";
+static char cola[]="]\n";
+
+int main(){
+	struct segmento segs[MAX_SEGMENTOS+1];
+	int n, i;
+
+	printf("prueba_escribirv: comienza\n");
+
+	segs[0].texto=cabecera;
+	segs[0].longi=sizeof(cabecera)-1;
+	segs[1].texto=contenido;
+	segs[1].longi=sizeof(contenido)-1;
+	segs[2].texto=cola;
+	segs[2].longi=sizeof(cola)-1;
+	if ((n=escribirv(segs, 3))!=sizeof(cabecera)+sizeof(contenido)+sizeof(cola)-3)
+		printf("error: escritos %d bytes. NO DEBE APARECER\n", n);
+
+	/* una lista vacia no escribe nada */
+	if (escribirv(segs, 0)!=0)
+		printf("error en lista vacia. NO DEBE APARECER\n");
+
+	/* demasiados segmentos */
+	for (i=0; i<=MAX_SEGMENTOS; i++)
+		segs[i]=segs[2];
+	if (escribirv(segs, MAX_SEGMENTOS+1)>=0)
+		printf("error: demasiados segmentos. NO DEBE APARECER\n");
+
+	/* segmento sin direccion: no se escribe nada de la lista */
+	segs[0].texto=cabecera;
+	segs[1].texto=0;
+	if (escribirv(segs, 3)>=0)
+		printf("error: segmento nulo. NO DEBE APARECER\n");
+
+	printf("prueba_escribirv: termina\n");
+	return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * usuario/prueba_estad.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que realiza una prueba de las estadisticas de
+ * llamadas al sistema
+ */
+
+#include "servicios.h"
+
+static void mostrar(char *nombre, int servicio){
+	struct estad_llamada e;
+	int i;
+
+	if (obtener_estad_llamadas(servicio, &e, 1)<0)
+		printf("error obteniendo estadisticas. NO DEBE APARECER\n");
+	printf("prueba_estad: %s: %lu veces, %lu errores, latencia:",
+		nombre, e.llamadas, e.errores);
+	for (i=0; i<NUM_CUBETAS_LATENCIA; i++)
+		printf(" %lu", e.latencia[i]);
+	printf("\n");
+}
+
+int main(){
+	int i;
+	struct estad_llamada e;
+
+	printf("prueba_estad: comienza\n");
+
+	for (i=0; i<10; i++)
+		tiempos_proceso(0);
+	fijar_prioridad(NUM_PRIORIDADES);	/* prioridad no valida: error */
+	fijar_prioridad(PRIORIDAD_DEFECTO);
+	dormir(1);
+
+	/* 10 llamadas sin errores y 2 llamadas con un error */
+	mostrar("tiempos_proceso", LLAMADA_TIEMPOS_PROCESO);
+	mostrar("fijar_prioridad", LLAMADA_FIJAR_PRIORIDAD);
+	/* dormir 1 segundo son 100 ticks: cubeta [64, 128) */
+	mostrar("dormir", LLAMADA_DORMIR);
+
+	if (obtener_estad_llamadas(-1, &e, 0)>=0)
+		printf("error: servicio inexistente. NO DEBE APARECER\n");
+
+	printf("prueba_estad: termina\n");
+	return 0;
+}
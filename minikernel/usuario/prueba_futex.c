@@ -0,0 +1,77 @@
+/*
+ * usuario/prueba_futex.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que prueba el camino rapido de lock/unlock: dos
+ * procesos incrementan un contador compartido protegido por un mutex y
+ * solo deben entrar al kernel cuando coinciden
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+#define NUM_ITER 2000000
+
+int segundo=0;
+volatile int abierto=0;
+int terminados=0;
+volatile long contador=0;
+
+int main(){
+	int desc, i, id;
+	struct estad_llamada el, eu;
+
+	id=obtener_id_pr();
+	if (!segundo)
+	{
+		segundo=1;
+		if ((desc=crear_mutex("cuenta", RECURSIVO))<0)
+			printf("error creando mutex. NO DEBE APARECER\n");
+		if (crear_proceso("prueba_futex")<0)
+			printf("error creando proceso. NO DEBE APARECER\n");
+	}
+	else
+	{
+		if ((desc=abrir_mutex("cuenta"))<0)
+			printf("error abriendo mutex. NO DEBE APARECER\n");
+		abierto=1;
+	}
+
+	/* espera activa a que ambos tengan el mutex abierto: el round-robin
+	   hace que se alternen durante los bucles */
+	while (!abierto);
+
+	for (i=0; i<NUM_ITER; i++)
+	{
+		if (lock(desc)<0)
+			printf("error en lock. NO DEBE APARECER\n");
+		/* bloqueo recursivo: tampoco entra al kernel */
+		if (lock(desc)<0)
+			printf("error en lock recursivo. NO DEBE APARECER\n");
+		contador++;
+		unlock(desc);
+		if (unlock(desc)<0)
+			printf("error en unlock. NO DEBE APARECER\n");
+	}
+
+	/* el mutex ya esta libre */
+	if (unlock(desc)>=0)
+		printf("unlock de mutex libre. NO DEBE APARECER\n");
+
+	obtener_estad_llamadas(LLAMADA_LOCK, &el, 1);
+	obtener_estad_llamadas(LLAMADA_UNLOCK, &eu, 1);
+	printf("prueba_futex (%d): %d lock y unlock, %lu llamadas lock y %lu unlock\n",
+		id, 2*NUM_ITER, el.llamadas, eu.llamadas-1);
+
+	if (++terminados==2)
+	{
+		if (contador!=2*NUM_ITER)
+			printf("error: contador %ld. NO DEBE APARECER\n", contador);
+		printf("prueba_futex: contador %ld\n", contador);
+	}
+	return 0;
+}
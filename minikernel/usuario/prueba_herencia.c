@@ -0,0 +1,91 @@
+/*
+ * usuario/prueba_herencia.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que prueba la herencia de prioridad en una cadena
+ * de mutex: L (prioridad 20) tiene a, X (12) tiene b y espera a, y H (5)
+ * espera b. L hereda la prioridad de H a traves de X, por lo que M (10),
+ * que consume CPU sin parar, no puede retrasar a H
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+#define TICKS_L 50		/* ticks de CPU de L con el mutex */
+#define TICKS_M 300		/* ticks de CPU de M */
+
+int creado=0;
+int hijos=0;
+char orden[5];
+int num_fin=0;
+
+static void fin(char quien){
+	orden[num_fin++]=quien;
+	if (num_fin<4)
+		return;
+	orden[4]='\0';
+	/* H debe acabar antes que M */
+	if (orden[0]!='H')
+		printf("prueba_herencia: orden %s. NO DEBE APARECER\n", orden);
+	else
+		printf("prueba_herencia: orden de terminacion %s\n", orden);
+}
+
+int main(){
+	int a, b, n;
+
+	if (!creado)
+	{
+		creado=1;
+		fijar_prioridad(20);
+		a=crear_mutex("a", NO_RECURSIVO);
+		b=crear_mutex("b", NO_RECURSIVO);
+		if (a<0 || b<0 || lock(a)<0)
+			printf("error creando mutex. NO DEBE APARECER\n");
+
+		/* X empieza con mas prioridad que L: se bloquea en a antes de
+		   que L cree a los demas */
+		for (n=0; n<3; n++)
+			if (crear_proceso("prueba_herencia")<0)
+				printf("error creando proceso. NO DEBE APARECER\n");
+
+		/* mientras L duerme H se bloquea en b y M empieza a consumir */
+		dormir(1);
+		consumir(TICKS_L);
+		unlock(a);
+		fin('L');
+		return 0;
+	}
+
+	n=++hijos;
+	a=abrir_mutex("a");
+	b=abrir_mutex("b");
+	if (a<0 || b<0)
+		printf("error abriendo mutex. NO DEBE APARECER\n");
+	switch (n)
+	{
+	case 1:
+		fijar_prioridad(12);
+		lock(b);
+		lock(a);
+		unlock(a);
+		unlock(b);
+		fin('X');
+		break;
+	case 2:
+		fijar_prioridad(5);
+		lock(b);
+		unlock(b);
+		fin('H');
+		break;
+	default:
+		fijar_prioridad(10);
+		consumir(TICKS_M);
+		fin('M');
+	}
+	return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * usuario/prueba_hilos.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que realiza una prueba de la llamada crear_hilo:
+ * los hilos comparten las variables globales del programa
+ */
+
+#include "servicios.h"
+
+#define NUM_HILOS 3
+
+int contador=0;		/* compartido por todos los hilos */
+
+static void hilo(void *arg){
+	int n=*(int *)arg;
+
+	printf("hilo %d (id %d): comienza\n", n, obtener_id_pr());
+	contador+=n;
+	printf("hilo %d: termina\n", n);
+}
+
+int main(){
+	int i;
+	static int args[NUM_HILOS];
+
+	printf("prueba_hilos: comienza\n");
+
+	for (i=0; i<NUM_HILOS; i++) {
+		args[i]=i+1;
+		if (crear_hilo(hilo, &args[i])<0)
+			printf("error creando hilo %d. NO DEBE APARECER\n", i+1);
+	}
+
+	printf("prueba_hilos duerme 1 seg.: deben ejecutar los hilos\n");
+	dormir(1);
+
+	if (contador!=6)
+		printf("error: contador %d distinto de 6. NO DEBE APARECER\n", contador);
+	else
+		printf("prueba_hilos: contador compartido correcto\n");
+
+	printf("prueba_hilos: termina\n");
+	return 0;
+}
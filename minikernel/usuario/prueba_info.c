@@ -0,0 +1,53 @@
+/*
+ * usuario/prueba_info.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que realiza una prueba de la pagina de informacion
+ * del kernel: lee el id y el tiempo sin hacer llamadas al sistema
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+#define NUM_HIJOS 2
+
+int hijos_creados=0;
+
+int main(){
+	int i, id, ids[NUM_HIJOS];
+	unsigned long antes, despues;
+	struct info_kernel *info;
+
+	if (obtener_info_kernel(&info)<0)
+		printf("error obteniendo la pagina. NO DEBE APARECER\n");
+
+	id=obtener_id_pr();
+	printf("prueba_info (%d): comienza con %d listos\n", id, info->num_listos);
+
+	/* los hijos ejecutan este mismo programa sin crear mas procesos */
+	if (!hijos_creados)
+	{
+		hijos_creados=1;
+		if (crear_procesos("prueba_info", NUM_HIJOS, ids)!=NUM_HIJOS)
+			printf("error creando procesos. NO DEBE APARECER\n");
+		printf("prueba_info (%d): creados %d y %d, listos %d\n",
+			id, ids[0], ids[1], info->num_listos);
+	}
+
+	for (i=0; i<3; i++)
+	{
+		antes=obtener_ticks();
+		dormir(1);
+		despues=obtener_ticks();
+		if (obtener_id_pr()!=id)
+			printf("error: id %d incorrecto. NO DEBE APARECER\n", obtener_id_pr());
+		printf("prueba_info (%d): dormido %lu ticks\n", id, despues-antes);
+	}
+
+	printf("prueba_info (%d): termina\n", id);
+	return 0;
+}
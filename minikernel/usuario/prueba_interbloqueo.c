@@ -0,0 +1,58 @@
+/*
+ * usuario/prueba_interbloqueo.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que prueba la deteccion de interbloqueos: el padre
+ * tiene a y espera b, el hijo tiene b y al pedir a cerraria el ciclo, por
+ * lo que su lock falla con ERROR_INTERBLOQUEO. Al soltar b el hijo, el
+ * padre continua
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+int creado=0;
+
+int main(){
+	int a, b, res;
+
+	if (!creado)
+	{
+		creado=1;
+		a=crear_mutex("a", NO_RECURSIVO);
+		b=crear_mutex("b", NO_RECURSIVO);
+		if (a<0 || b<0 || lock(a)<0)
+			printf("error creando mutex. NO DEBE APARECER\n");
+		if (crear_proceso("prueba_interbloqueo")<0)
+			printf("error creando proceso. NO DEBE APARECER\n");
+
+		/* el hijo bloquea b mientras el padre duerme */
+		dormir(1);
+		printf("prueba_interbloqueo: padre espera b\n");
+		if (lock(b)<0)
+			printf("error en lock de b. NO DEBE APARECER\n");
+		printf("prueba_interbloqueo: padre consigue b\n");
+		unlock(b);
+		unlock(a);
+	}
+	else
+	{
+		a=abrir_mutex("a");
+		b=abrir_mutex("b");
+		if (a<0 || b<0 || lock(b)<0)
+			printf("error abriendo mutex. NO DEBE APARECER\n");
+
+		/* el padre se bloquea en b mientras el hijo duerme */
+		dormir(2);
+		if ((res=lock(a))!=ERROR_INTERBLOQUEO)
+			printf("lock de a devuelve %d. NO DEBE APARECER\n", res);
+		else
+			printf("prueba_interbloqueo: hijo detecta interbloqueo al pedir a\n");
+		unlock(b);
+	}
+	return 0;
+}
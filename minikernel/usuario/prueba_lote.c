@@ -0,0 +1,37 @@
+/*
+ * usuario/prueba_lote.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que realiza una prueba de la llamada crear_procesos
+ */
+
+#include "servicios.h"
+
+#define NUM_HIJOS 5
+
+int main(){
+	int i, n;
+	int ids[NUM_HIJOS];
+
+	printf("prueba_lote: comienza\n");
+
+	if ((n=crear_procesos("mudo", NUM_HIJOS, ids))!=NUM_HIJOS)
+		printf("error creando %d mudo (creados %d). NO DEBE APARECER\n", NUM_HIJOS, n);
+
+	for (i=0; i<n; i++)
+		printf("prueba_lote: creado mudo con id %d\n", ids[i]);
+
+	if (crear_procesos("noexiste", 2, ids)>=0)
+		printf("error: creados procesos de noexiste. NO DEBE APARECER\n");
+
+	/* mas de los que caben en la tabla: se rechaza sin crear ninguno */
+	if (crear_procesos("mudo", 1000000000, ids)>=0)
+		printf("error: creados 1000000000 mudo. NO DEBE APARECER\n");
+
+	printf("prueba_lote: termina\n");
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * usuario/prueba_nombres.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que prueba el espacio de nombres de mutex con
+ * muchos mas mutex de los que cabian en la tabla fija original
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+#define NUM_HIJOS 40
+#define MUTEX_POR_HIJO 4
+
+int hijos_creados=0;
+
+/* construye el nombre "s<id>_<k>" */
+static void nombre_mutex(char *nombre, int id, int k){
+	char cifras[8];
+	int n=0, i=0;
+
+	nombre[i++]='s';
+	do {
+		cifras[n++]='0'+id%10;
+		id/=10;
+	} while (id>0);
+	while (n>0)
+		nombre[i++]=cifras[--n];
+	nombre[i++]='_';
+	nombre[i++]='0'+k;
+	nombre[i]='\0';
+}
+
+int main(){
+	int ids[NUM_HIJOS];
+	int i, id;
+	char nombre[16];
+
+	if (!hijos_creados)
+	{
+		hijos_creados=1;
+		printf("prueba_nombres: crea %d procesos con %d mutex cada uno\n",
+			NUM_HIJOS, MUTEX_POR_HIJO);
+		if (crear_procesos("prueba_nombres", NUM_HIJOS, ids)!=NUM_HIJOS)
+			printf("error creando procesos. NO DEBE APARECER\n");
+		dormir(1);
+		/* todos los mutex siguen abiertos por sus creadores */
+		nombre_mutex(nombre, ids[NUM_HIJOS-1], MUTEX_POR_HIJO-1);
+		if (abrir_mutex(nombre)<0)
+			printf("error abriendo %s. NO DEBE APARECER\n", nombre);
+		printf("prueba_nombres: termina\n");
+		return 0;
+	}
+
+	id=obtener_id_pr();
+	for (i=0; i<MUTEX_POR_HIJO; i++)
+	{
+		nombre_mutex(nombre, id, i);
+		if (crear_mutex(nombre, NO_RECURSIVO)<0)
+			printf("error creando %s. NO DEBE APARECER\n", nombre);
+	}
+	/* el nombre ya existe */
+	if (crear_mutex(nombre, NO_RECURSIVO)>=0)
+		printf("creado %s dos veces. NO DEBE APARECER\n", nombre);
+
+	dormir(2);
+	return 0;
+}
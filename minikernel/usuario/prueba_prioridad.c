@@ -0,0 +1,44 @@
+/*
+ * usuario/prueba_prioridad.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que realiza una prueba de la planificacion por
+ * prioridades y de la llamada fijar_prioridad
+ */
+
+#include "servicios.h"
+
+#define TOT_ITER 20000000	/* ponga las que considere oportuno */
+
+int main(){
+	int i, tot;
+	int j=5;
+
+	printf("prueba_prioridad: comienza\n");
+
+	for (i=1; i<=2; i++)
+		if (crear_proceso("mudo")<0)
+			printf("Error creando mudo\n");
+
+	/* pasa a ser el mas prioritario: los mudo no deben ejecutar */
+	if (fijar_prioridad(0)!=PRIORIDAD_DEFECTO)
+		printf("error fijando prioridad. NO DEBE APARECER\n");
+
+	for (i=0; i<TOT_ITER; i++)
+		tot=j*i;
+	printf("prueba_prioridad: fin del calculo. NO DEBE HABER EXPULSIONES\n");
+
+	if (fijar_prioridad(NUM_PRIORIDADES)>=0)
+		printf("error: prioridad fuera de rango aceptada. NO DEBE APARECER\n");
+
+	/* pasa a ser el menos prioritario: deben ejecutar los mudo */
+	fijar_prioridad(NUM_PRIORIDADES-1);
+
+	printf("prueba_prioridad: termina. DEBE APARECER DESPUES DE LOS mudo\n");
+	tot--;
+	return 0;
+}
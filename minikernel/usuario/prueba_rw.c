@@ -0,0 +1,108 @@
+/*
+ * usuario/prueba_rw.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que prueba los cerrojos de lectura/escritura: tres
+ * lectores que esperan a un escritor entran juntos al soltarlo, un
+ * escritor espera a que salgan y un lector que llega mientras el escritor
+ * espera no se le adelanta (preferencia de escritura), aunque los que ya
+ * estan dentro pueden volver a bloquearlo en lectura
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+#define NUM_LECTORES 3
+
+int creados=0;
+int hijos=0;
+int leyendo=0, max_leyendo=0;
+int escrito=0;
+
+static void lector(int rw){
+	if (lock_lectura(rw)<0)
+		printf("error en lock_lectura. NO DEBE APARECER\n");
+	if (++leyendo>max_leyendo)
+		max_leyendo=leyendo;
+	printf("prueba_rw: lector %d dentro con %d lectores\n", obtener_id_pr(), leyendo);
+	dormir(3);
+
+	/* el escritor esta esperando: una segunda lectura del mismo proceso
+	   no debe esperar tras el */
+	if (lock_lectura(rw)<0)
+		printf("error en segundo lock_lectura. NO DEBE APARECER\n");
+	if (escrito)
+		printf("escritor con lectores dentro. NO DEBE APARECER\n");
+	if (unlock_rw(rw)<0)
+		printf("error en unlock_rw. NO DEBE APARECER\n");
+
+	leyendo--;
+	if (unlock_rw(rw)<0)
+		printf("error en unlock_rw. NO DEBE APARECER\n");
+}
+
+static void lector_tardio(int rw){
+	dormir(2);
+	/* hay un escritor esperando: no debe entrar con los otros lectores */
+	if (lock_lectura(rw)<0)
+		printf("error en lock_lectura. NO DEBE APARECER\n");
+	if (!escrito)
+		printf("lector adelanta al escritor. NO DEBE APARECER\n");
+	printf("prueba_rw: lector tardio %d dentro despues del escritor\n", obtener_id_pr());
+	unlock_rw(rw);
+	if (unlock_rw(rw)>=0)
+		printf("unlock_rw sin tenerlo. NO DEBE APARECER\n");
+}
+
+static void escritor(int rw){
+	if (lock_escritura(rw)<0)
+		printf("error en lock_escritura. NO DEBE APARECER\n");
+	if (lock_lectura(rw)>=0 || lock_escritura(rw)>=0)
+		printf("bloqueo doble. NO DEBE APARECER\n");
+
+	for (creados=1; creados<=NUM_LECTORES+1; creados++)
+		if (crear_proceso("prueba_rw")<0)
+			printf("error creando proceso. NO DEBE APARECER\n");
+
+	/* los lectores se quedan esperando y entran todos al soltarlo */
+	dormir(1);
+	unlock_rw(rw);
+
+	if (lock_escritura(rw)<0)
+		printf("error en lock_escritura. NO DEBE APARECER\n");
+	if (leyendo!=0)
+		printf("escritor con %d lectores. NO DEBE APARECER\n", leyendo);
+	printf("prueba_rw: escritor dentro, llegaron a leer %d lectores a la vez\n", max_leyendo);
+	escrito=1;
+	unlock_rw(rw);
+}
+
+int main(){
+	int rw, n;
+
+	if (creados==0)
+	{
+		if ((rw=crear_rw("tabla"))<0)
+			printf("error creando cerrojo. NO DEBE APARECER\n");
+		if (lock(rw)>=0 || abrir_mutex("tabla")>=0)
+			printf("cerrojo usado como mutex. NO DEBE APARECER\n");
+		escritor(rw);
+	}
+	else
+	{
+		n=++hijos;
+		if ((rw=abrir_rw("tabla"))<0)
+			printf("error abriendo cerrojo. NO DEBE APARECER\n");
+		if (n<=NUM_LECTORES)
+			lector(rw);
+		else
+			lector_tardio(rw);
+	}
+	if (cerrar_rw(rw)<0)
+		printf("error cerrando cerrojo. NO DEBE APARECER\n");
+	return 0;
+}
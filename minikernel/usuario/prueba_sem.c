@@ -0,0 +1,77 @@
+/*
+ * usuario/prueba_sem.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que prueba los semaforos: un solo senalar_sem de 3
+ * unidades despierta a tres procesos, y un proceso que pide 3 unidades no
+ * es adelantado por otro que llega despues pidiendo 1 (orden de llegada)
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+#define NUM_HIJOS 5
+
+int creados=0;
+int hijos=0;
+int despiertos=0;
+
+/* unidades que pide cada hijo y segundos que tarda en pedirlas */
+int pide[NUM_HIJOS+1]={0, 1, 1, 1, 3, 1};
+int tarda[NUM_HIJOS+1]={0, 0, 0, 0, 1, 2};
+
+static void senalar(int sem, int n, int esperados){
+	if (senalar_sem(sem, n)<0)
+		printf("error en senalar_sem. NO DEBE APARECER\n");
+	dormir(1);
+	if (despiertos!=esperados)
+		printf("despiertos %d en vez de %d. NO DEBE APARECER\n", despiertos, esperados);
+}
+
+int main(){
+	int sem, n;
+
+	if (creados==0)
+	{
+		creados=1;
+		if ((sem=crear_sem("recursos", 0))<0)
+			printf("error creando semaforo. NO DEBE APARECER\n");
+		if (crear_sem("otro", -1)>=0 || esperar_sem(sem, 0)>=0 || lock(sem)>=0)
+			printf("uso no valido aceptado. NO DEBE APARECER\n");
+		for (n=1; n<=NUM_HIJOS; n++)
+			if (crear_proceso("prueba_sem")<0)
+				printf("error creando proceso. NO DEBE APARECER\n");
+
+		/* todos los hijos estan esperando */
+		dormir(3);
+		senalar(sem, 3, 3);
+		/* el hijo 4 espera 3 unidades y el 5 va detras aunque pida 1 */
+		senalar(sem, 2, 3);
+		senalar(sem, 1, 4);
+		senalar(sem, 1, 5);
+		printf("prueba_sem: %d procesos despertados en orden\n", despiertos);
+
+		/* sin nadie esperando el valor llega al maximo de un int y no
+		   puede pasar de ahi */
+		if (senalar_sem(sem, 0x7fffffff)<0 || senalar_sem(sem, 1)>=0)
+			printf("desbordamiento de semaforo aceptado. NO DEBE APARECER\n");
+	}
+	else
+	{
+		n=++hijos;
+		if ((sem=abrir_sem("recursos"))<0)
+			printf("error abriendo semaforo. NO DEBE APARECER\n");
+		dormir(tarda[n]);
+		if (esperar_sem(sem, pide[n])<0)
+			printf("error en esperar_sem. NO DEBE APARECER\n");
+		despiertos++;
+		printf("prueba_sem: hijo %d obtiene %d unidades\n", n, pide[n]);
+	}
+	if (cerrar_sem(sem)<0)
+		printf("error cerrando semaforo. NO DEBE APARECER\n");
+	return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * usuario/prueba_temporizado.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que prueba lock_temporizado: mientras el padre
+ * tiene el mutex el hijo lo intenta sin esperar, luego esperando un plazo
+ * que vence y por ultimo con un plazo mayor que le da tiempo a obtenerlo.
+ * Al final el padre lo suelta mientras el hijo espera pero vuelve a
+ * bloquearlo antes de que el hijo ejecute y despues de que venza su plazo:
+ * el hijo no debe volver a esperar. Por ultimo se repite con un segundo
+ * hijo esperando detras del primero sin plazo: el primero, al rendirse,
+ * no debe dejarlo bloqueado para siempre
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+int creado=0;
+volatile int bloqueado=0;
+volatile int fin_fase1=0;
+volatile int rebloqueado=0;
+volatile int fin_fase2=0;
+volatile int fase3=0;
+volatile int conseguido=0;
+
+int main(){
+	int desc, res;
+	unsigned long t;
+
+	if (creado==2)
+	{
+		/* segundo hijo: espera sin plazo detras del primero */
+		if ((desc=abrir_mutex("plazo"))<0)
+			printf("error abriendo mutex. NO DEBE APARECER\n");
+		if (lock(desc)<0)
+			printf("error en lock. NO DEBE APARECER\n");
+		conseguido=1;
+		printf("prueba_temporizado: segundo hijo consigue el mutex\n");
+		unlock(desc);
+	}
+	else if (!creado)
+	{
+		creado=1;
+		if ((desc=crear_mutex("plazo", NO_RECURSIVO))<0)
+			printf("error creando mutex. NO DEBE APARECER\n");
+		if (lock(desc)<0)
+			printf("error en lock. NO DEBE APARECER\n");
+		bloqueado=1;
+		if (crear_proceso("prueba_temporizado")<0)
+			printf("error creando proceso. NO DEBE APARECER\n");
+
+		dormir(3);
+		printf("prueba_temporizado: padre desbloquea el mutex\n");
+		if (unlock(desc)<0)
+			printf("error en unlock. NO DEBE APARECER\n");
+
+		/* el hijo espera con un plazo de 150 ticks */
+		while (!fin_fase1);
+		if (lock(desc)<0)
+			printf("error en lock. NO DEBE APARECER\n");
+		rebloqueado=1;
+		dormir(1);
+
+		/* con mas prioridad que el hijo lo suelta, deja pasar su plazo
+		   sin que ejecute y lo vuelve a bloquear */
+		fijar_prioridad(2);
+		if (unlock(desc)<0)
+			printf("error en unlock. NO DEBE APARECER\n");
+		consumir(200);
+		if (lock(desc)<0)
+			printf("error en lock. NO DEBE APARECER\n");
+		fijar_prioridad(PRIORIDAD_DEFECTO);
+
+		/* el primer hijo espera con plazo de 300 ticks y el segundo sin
+		   plazo detras de el. Se suelta despertando al primero, se vuelve
+		   a bloquear y se deja pasar su plazo: al rendirse debe dejar el
+		   bit de espera activo para que el unlock despierte al segundo */
+		while (!fin_fase2);
+		fase3=1;
+		dormir(1);
+		creado=2;
+		if (crear_proceso("prueba_temporizado")<0)
+			printf("error creando proceso. NO DEBE APARECER\n");
+		dormir(1);
+		fijar_prioridad(2);
+		if (unlock(desc)<0)
+			printf("error en unlock. NO DEBE APARECER\n");
+		if (lock(desc)<0)
+			printf("error en lock. NO DEBE APARECER\n");
+		consumir(150);
+		fijar_prioridad(PRIORIDAD_DEFECTO);
+		dormir(1);
+		unlock(desc);
+		dormir(1);
+		if (!conseguido)
+			printf("segundo hijo sigue bloqueado. NO DEBE APARECER\n");
+	}
+	else
+	{
+		if ((desc=abrir_mutex("plazo"))<0)
+			printf("error abriendo mutex. NO DEBE APARECER\n");
+		while (!bloqueado);
+
+		if (lock_temporizado(desc, 0)!=ERROR_PLAZO)
+			printf("lock sin espera de mutex ocupado. NO DEBE APARECER\n");
+
+		t=obtener_ticks();
+		if ((res=lock_temporizado(desc, 50))!=ERROR_PLAZO)
+			printf("lock_temporizado devuelve %d. NO DEBE APARECER\n", res);
+		t=obtener_ticks()-t;
+		if (t<50 || t>60)
+			printf("plazo vencido tras %lu ticks. NO DEBE APARECER\n", t);
+		printf("prueba_temporizado: hijo no consigue el mutex en 50 ticks\n");
+
+		/* el padre lo suelta antes de que venza este plazo */
+		if (lock_temporizado(desc, 1000)<0)
+			printf("error en lock_temporizado. NO DEBE APARECER\n");
+		printf("prueba_temporizado: hijo consigue el mutex antes del plazo\n");
+
+		/* el plazo anterior ya no esta en la lista del reloj */
+		dormir(1);
+		if (unlock(desc)<0)
+			printf("error en unlock. NO DEBE APARECER\n");
+		if (lock_temporizado(NUM_MUT_PROC, 10)!=-1)
+			printf("lock_temporizado de descriptor invalido. NO DEBE APARECER\n");
+
+		fin_fase1=1;
+		while (!rebloqueado);
+		t=obtener_ticks();
+		if ((res=lock_temporizado(desc, 150))!=ERROR_PLAZO)
+			printf("lock_temporizado devuelve %d. NO DEBE APARECER\n", res);
+		t=obtener_ticks()-t;
+		if (t>=400)
+			printf("plazo vencido tras %lu ticks. NO DEBE APARECER\n", t);
+		printf("prueba_temporizado: hijo adelantado tras un unlock no vuelve a esperar\n");
+
+		fin_fase2=1;
+		while (!fase3);
+		if ((res=lock_temporizado(desc, 300))!=ERROR_PLAZO)
+			printf("lock_temporizado devuelve %d. NO DEBE APARECER\n", res);
+		printf("prueba_temporizado: hijo adelantado se rinde con otro esperando\n");
+	}
+	return 0;
+}
@@ -32,8 +32,11 @@ int main(){
 
 	printf("PRIMERA FASE: HACE LLAMADAS AL SISTEMA\n");
 	
+	/* con buffer completo las escrituras se agrupan en pocas llamadas */
+	fijar_modo_salida(SALIDA_COMPLETA);
         for (i=0; i<TOT_ITER_FASE1; i++)
                 printf("prueba_tiempos: i %d\n", i);
+	fijar_modo_salida(SALIDA_POR_LINEAS);
 
 	printf("FIN PRIMERA FASE\n");
 	t1=tiempos_proceso(&tiempos_f1);
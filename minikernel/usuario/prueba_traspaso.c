@@ -0,0 +1,94 @@
+/*
+ * usuario/prueba_traspaso.c
+ *
+ *  Minikernel. Versión 1.0
+ *
+ */
+
+/*
+ * Programa de usuario que compara las dos politicas de unlock: tres
+ * procesos compiten por un mutex normal y por otro creado con TRASPASO.
+ * En el primero los despertados pueden encontrarlo ocupado de nuevo; en el
+ * segundo el unlock se lo cede directamente y nunca fallan
+ */
+
+#include "servicios.h"
+#include "pruebas.h"
+
+#define NUM_PROCESOS 3
+#define NUM_ITER 40
+#define ESPERA 2000000
+
+int creados=0;
+volatile int abiertos=0;
+int terminados=0;
+
+static void competir(int desc){
+	int i;
+	volatile int j;
+
+	for (i=0; i<NUM_ITER; i++)
+	{
+		if (lock(desc)<0)
+			printf("error en lock. NO DEBE APARECER\n");
+		/* seccion critica larga para que la rodaja expire dentro */
+		for (j=0; j<ESPERA; j++);
+		if (unlock(desc)<0)
+			printf("error en unlock. NO DEBE APARECER\n");
+		for (j=0; j<ESPERA/4; j++);
+	}
+}
+
+static void mostrar(char *nombre, int desc){
+	struct estad_mutex e;
+
+	if (estad_mutex(desc, &e)<0)
+		printf("error en estad_mutex. NO DEBE APARECER\n");
+	printf("prueba_traspaso: %s: %lu esperas, %lu traspasos, %lu fallos de readquisicion\n",
+		nombre, e.esperas, e.traspasos, e.fallos_readquisicion);
+}
+
+int main(){
+	int libre, cedido;
+
+	if (creados==0)
+	{
+		creados=1;
+		if ((libre=crear_mutex("libre", NO_RECURSIVO))<0)
+			printf("error creando libre. NO DEBE APARECER\n");
+		if ((cedido=crear_mutex("cedido", NO_RECURSIVO|TRASPASO))<0)
+			printf("error creando cedido. NO DEBE APARECER\n");
+		while (creados<NUM_PROCESOS)
+		{
+			creados++;
+			if (crear_proceso("prueba_traspaso")<0)
+				printf("error creando proceso. NO DEBE APARECER\n");
+		}
+	}
+	else
+	{
+		if ((libre=abrir_mutex("libre"))<0)
+			printf("error abriendo libre. NO DEBE APARECER\n");
+		if ((cedido=abrir_mutex("cedido"))<0)
+			printf("error abriendo cedido. NO DEBE APARECER\n");
+	}
+
+	/* espera activa a que todos tengan los mutex abiertos */
+	abiertos++;
+	while (abiertos<NUM_PROCESOS);
+
+	competir(libre);
+	competir(cedido);
+
+	/* un descriptor invalido */
+	if (estad_mutex(NUM_MUT_PROC, 0)>=0)
+		printf("estad_mutex con descriptor invalido. NO DEBE APARECER\n");
+
+	/* el ultimo en acabar muestra los contadores */
+	if (++terminados==NUM_PROCESOS)
+	{
+		mostrar("libre", libre);
+		mostrar("cedido", cedido);
+	}
+	return 0;
+}